@@ -25,6 +25,10 @@ OBSTACLES_MULTITASK = [
 
 
 def make_env_multitask(multitask_name, task_idx, num_envs, num_agents_per_env, num_simulation_threads, use_vulkan=False, params=None):
+    """
+    With task_idx=None all tasks run in a single MegaverseEnv (one thread pool, one batched renderer),
+    with num_envs envs of every task.
+    """
     assert 'multitask' in multitask_name
     if multitask_name.endswith('megaverse8'):
         tasks = MEGAVERSE8
@@ -33,6 +37,10 @@ def make_env_multitask(multitask_name, task_idx, num_envs, num_agents_per_env, n
     else:
         raise NotImplementedError()
 
+    if task_idx is None:
+        print('Multi-task, all scenarios in one env', tasks)
+        return MegaverseEnv(tasks, num_envs * len(tasks), num_agents_per_env, num_simulation_threads, use_vulkan, params)
+
     scenario_idx = task_idx % len(tasks)
     scenario = tasks[scenario_idx]
     print('Multi-task, scenario', scenario_idx, scenario)
@@ -40,9 +48,31 @@ def make_env_multitask(multitask_name, task_idx, num_envs, num_agents_per_env, n
 
 
 class MegaverseEnv(gym.Env):
-    def __init__(self, scenario_name, num_envs, num_agents_per_env, num_simulation_threads, use_vulkan=False, params=None):
-        scenario_name = scenario_name.casefold()
-        self.scenario_name = scenario_name
+    def __init__(
+        self, scenario_name, num_envs, num_agents_per_env, num_simulation_threads, use_vulkan=False, params=None,
+        pregenerate_episodes=False, wait_policy='hybrid', frameskip=1, merge_static_geometry=False,
+        level_cache='', readback='blocking',
+    ):
+        """
+        :param scenario_name: a scenario name, or a list of names in which case env i runs scenario i % len(list)
+        :param num_agents_per_env: number of agents, or a list in which case env i has num_agents_per_env[i % len] agents
+        :param frameskip: every step() simulates this many frames with the same action and sums up the rewards,
+        only the last frame is rendered
+        :param merge_static_geometry: build the static layout of each episode as a single compound collision object
+        instead of one rigid body per box
+        :param level_cache: path to a file written by level_cache_generator, scenarios that support it decode levels
+        from the file instead of generating them on reset
+        :param readback: OpenGL renderer only. 'blocking', 'pbo' (asynchronous transfers through pixel buffers), or
+        'pbo_delayed' (observations lag one step behind, but rendering overlaps with the next simulation step)
+        """
+        if isinstance(scenario_name, str):
+            scenario_name = [scenario_name]
+        self.scenario_names = [s.casefold() for s in scenario_name]
+        self.scenario_name = self.scenario_names[0] if len(self.scenario_names) == 1 else 'multitask'
+
+        if isinstance(num_agents_per_env, int):
+            num_agents_per_env = [num_agents_per_env]
+        self.env_num_agents = [num_agents_per_env[i % len(num_agents_per_env)] for i in range(num_envs)]
 
         self.is_multiagent = True
 
@@ -55,9 +85,17 @@ class MegaverseEnv(gym.Env):
         self.use_vulkan = use_vulkan
 
         # total number of simulated agents
-        self.num_agents = num_envs * num_agents_per_env
+        self.num_agents = sum(self.env_num_agents)
         self.num_envs = num_envs
-        self.num_agents_per_env = num_agents_per_env
+        self.num_agents_per_env = num_agents_per_env[0] if len(num_agents_per_env) == 1 else num_agents_per_env
+
+        # env and agent index for every actor (i.e. every agent in the flattened list of all agents)
+        self.actors = [(env_i, agent_i) for env_i in range(num_envs) for agent_i in range(self.env_num_agents[env_i])]
+        self.actor_scenario_names = [self.scenario_names[env_i % len(self.scenario_names)] for env_i, _ in self.actors]
+        self.first_actor_idx = np.cumsum([0] + self.env_num_agents[:-1]).tolist()
+
+        # indices of actors whose episodes finished during the last step()
+        self.finished_actors = []
 
         float_params = {}
         if params is not None:
@@ -70,12 +108,19 @@ class MegaverseEnv(gym.Env):
         # float_params['episodeLengthSec'] = 1.0
 
         self.env = MegaverseGym(
-            self.scenario_name,
+            self.scenario_names,
             self.img_w, self.img_h, num_envs, num_agents_per_env, num_simulation_threads, use_vulkan, float_params,
+            pregenerate_episodes=pregenerate_episodes, wait_policy=wait_policy, frameskip=frameskip,
+            merge_static_geometry=merge_static_geometry, level_cache=level_cache,
+            readback=readback,
         )
 
-        # obtaining default reward shaping scheme
-        self.default_shaping_scheme = self.env.get_reward_shaping(0, 0)
+        # default reward shaping scheme of every scenario, scenarios have different sets of rewards
+        self.default_shaping_schemes = {}
+        for actor_idx, (env_i, agent_i) in enumerate(self.actors):
+            scenario = self.actor_scenario_names[actor_idx]
+            if scenario not in self.default_shaping_schemes:
+                self.default_shaping_schemes[scenario] = self.env.get_reward_shaping(env_i, agent_i)
 
         self.action_space = self.generate_action_space(self.env.action_space_sizes())
         self.observation_space = gym.spaces.Box(0, 255, (self.channels, self.img_h, self.img_w), dtype=np.uint8)
@@ -120,12 +165,11 @@ class MegaverseEnv(gym.Env):
 
     def observations(self):
         obs = []
-        for env_i in range(self.num_envs):
-            for agent_i in range(self.num_agents_per_env):
-                o = self.env.get_observation(env_i, agent_i)
-                o = o[:, :, :3]
-                o = np.transpose(o, (2, 0, 1))  # convert to CHW for PyTorch
-                obs.append(o)
+        for env_i, agent_i in self.actors:
+            o = self.env.get_observation(env_i, agent_i)
+            o = o[:, :, :3]
+            o = np.transpose(o, (2, 0, 1))  # convert to CHW for PyTorch
+            obs.append(o)
 
         return obs
 
@@ -134,26 +178,23 @@ class MegaverseEnv(gym.Env):
         return self.observations()
 
     def step(self, actions):
-        action_idx = 0
-        for env_i in range(self.num_envs):
-            for agent_i in range(self.num_agents_per_env):
-                self.env.set_actions(env_i, agent_i, actions[action_idx])
-                action_idx += 1
+        # decoded in C++ in the simulation threads
+        self.env.set_actions_batch(np.asarray(actions, dtype=np.int32).reshape(self.num_agents, -1))
 
         self.env.step()
 
-        dones, infos = [], []
+        dones = [False] * self.num_agents
+        infos = [{} for _ in range(self.num_agents)]
 
-        agent_i = 0
-        for env_i in range(self.num_envs):
-            done = self.env.is_done(env_i)  # currently no individual done per agent
-            dones.extend([done for _ in range(self.num_agents_per_env)])
-            if done:
-                infos.extend([dict(true_reward=float(self.env.true_objective(env_i, j))) for j in range(self.num_agents_per_env)])
-            else:
-                infos.extend([{} for _ in range(self.num_agents_per_env)])
-
-            agent_i += self.num_agents_per_env
+        # episode stats are accumulated in C++, here we only touch the agents that actually finished an episode
+        self.finished_actors = []
+        for env_i, agent_i, _, episode_return, episode_length, true_objective in self.env.get_episode_stats():
+            actor_idx = self.first_actor_idx[int(env_i)] + int(agent_i)
+            dones[actor_idx] = True  # currently no individual done per agent
+            infos[actor_idx] = dict(
+                true_reward=float(true_objective), episode_return=float(episode_return), episode_length=int(episode_length),
+            )
+            self.finished_actors.append(actor_idx)
 
         rewards = self.env.get_last_rewards()
 
@@ -174,26 +215,32 @@ class MegaverseEnv(gym.Env):
 
         rows = []
         for env_i in range(self.num_envs):
-            obs = [self.convert_obs(self.env.get_hires_observation(env_i, i)) for i in range(self.num_agents_per_env)]
+            obs = [self.convert_obs(self.env.get_hires_observation(env_i, i)) for i in range(self.env_num_agents[env_i])]
             obs_concat = np.concatenate(obs, axis=1)
             rows.append(obs_concat)
 
+        # envs with fewer agents get padded rows
+        row_w = max(r.shape[1] for r in rows)
+        rows = [np.pad(r, ((0, 0), (0, row_w - r.shape[1]), (0, 0))) for r in rows]
+
         obs_final = np.concatenate(rows, axis=0)
         cv2.imshow(f'agent_{id(self)}', obs_final)
         cv2.waitKey(1)
         return obs_final
 
-    def get_default_reward_shaping(self):
-        return self.default_shaping_scheme
+    def get_default_reward_shaping(self, actor_idx: int = 0):
+        """In multi-scenario mode every actor gets the scheme of its own scenario."""
+        return self.default_shaping_schemes[self.actor_scenario_names[actor_idx]]
 
     def get_current_reward_shaping(self, actor_idx: int):
-        env_idx = actor_idx // self.num_agents_per_env
-        agent_idx = actor_idx % self.num_agents_per_env
+        env_idx, agent_idx = self.actors[actor_idx]
         return self.env.get_reward_shaping(env_idx, agent_idx)
 
     def set_reward_shaping(self, reward_shaping: dict, actor_idx: int):
-        env_idx = actor_idx // self.num_agents_per_env
-        agent_idx = actor_idx % self.num_agents_per_env
+        """Rewards the scenario of the actor does not have are skipped."""
+        env_idx, agent_idx = self.actors[actor_idx]
+        known_rewards = self.default_shaping_schemes[self.actor_scenario_names[actor_idx]]
+        reward_shaping = {k: v for k, v in reward_shaping.items() if k in known_rewards}
         return self.env.set_reward_shaping(env_idx, agent_idx, reward_shaping)
 
     def close(self):
@@ -25,6 +25,15 @@ class TestEnv(TestCase):
         o = e.step(sample_actions(e))
         e.close()
 
+    def test_step_before_reset(self):
+        e = make_test_env(num_envs=1, num_agents_per_env=1, num_simulation_threads=1)
+        with self.assertRaises(RuntimeError):
+            e.step(sample_actions(e))
+
+        e.reset()
+        e.step(sample_actions(e))
+        e.close()
+
     def test_env_close_immediately(self):
         e = make_test_env(1, 1, 1)
         e.close()
@@ -139,6 +148,22 @@ class TestEnv(TestCase):
 
         e.close()
 
+    def test_reward_shaping_multiple_scenarios(self):
+        e = MegaverseEnv(['TowerBuilding', 'ObstaclesEasy'], num_envs=2, num_agents_per_env=2, num_simulation_threads=1, use_vulkan=True)
+
+        # actors 0, 1 run TowerBuilding, actors 2, 3 run ObstaclesEasy
+        tower_shaping, obstacles_shaping = e.get_default_reward_shaping(0), e.get_default_reward_shaping(2)
+        self.assertNotEqual(tower_shaping, obstacles_shaping)
+        self.assertEqual(obstacles_shaping, e.get_current_reward_shaping(3))
+
+        # rewards of other scenarios are skipped, the ones the scenario has are applied
+        new_reward_shaping = {k: v * 3 for k, v in tower_shaping.items()}
+        new_reward_shaping.update({k: v * 2 for k, v in obstacles_shaping.items()})
+        e.set_reward_shaping(new_reward_shaping, 2)
+        self.assertEqual({k: v * 2 for k, v in obstacles_shaping.items()}, e.get_current_reward_shaping(2))
+
+        e.close()
+
     def test_memleak(self):
         def mem_usage_kb():
             import psutil
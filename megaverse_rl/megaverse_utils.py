@@ -38,8 +38,6 @@ class Wrapper(gym.Wrapper, RewardShapingInterface, TrainingInfoInterface):
         self.num_agents = env.unwrapped.num_agents
         self.is_multiagent = env.unwrapped.is_multiagent
 
-        self.episode_rewards = [0] * self.num_agents
-
         self.increase_team_spirit = increase_team_spirit
         self.max_team_spirit_steps = max_team_spirit_steps
 
@@ -55,33 +53,30 @@ class Wrapper(gym.Wrapper, RewardShapingInterface, TrainingInfoInterface):
         return self.env.unwrapped.set_reward_shaping(reward_shaping, agent_idx)
 
     def reset(self, **kwargs):
-        self.episode_rewards = [0] * self.num_agents
         return self.env.reset(), {}
 
     def step(self, action):
         obs, rewards, dones, infos = self.env.step(action)
 
-        for i, info in enumerate(infos):
-            self.episode_rewards[i] += rewards[i]
-
-            if dones[i]:
-                if "episode_extra_stats" not in info:
-                    info["episode_extra_stats"] = dict()
-                extra_stats = info["episode_extra_stats"]
-                info["true_objective"] = info["true_reward"]
-                extra_stats[f"z_{self.env.unwrapped.scenario_name.casefold()}_true_objective"] = info["true_reward"]
-                extra_stats[f"z_{self.env.unwrapped.scenario_name.casefold()}_reward"] = self.episode_rewards[i]
-
-                approx_total_training_steps = self.training_info.get("approx_total_training_steps", 0)
-                extra_stats["z_approx_total_training_steps"] = approx_total_training_steps
-
-                self.episode_rewards[i] = 0
-
-                if self.increase_team_spirit:
-                    rew_shaping = self.get_current_reward_shaping(i)
-                    rew_shaping["teamSpirit"] = min(approx_total_training_steps / self.max_team_spirit_steps, 1.0)
-                    self.set_reward_shaping(rew_shaping, i)
-                    extra_stats["teamSpirit"] = rew_shaping["teamSpirit"]
+        # episode returns are accumulated in C++, only visit the agents that finished their episodes
+        for i in self.env.unwrapped.finished_actors:
+            info = infos[i]
+            if "episode_extra_stats" not in info:
+                info["episode_extra_stats"] = dict()
+            extra_stats = info["episode_extra_stats"]
+            info["true_objective"] = info["true_reward"]
+            scenario_name = self.env.unwrapped.actor_scenario_names[i]
+            extra_stats[f"z_{scenario_name}_true_objective"] = info["true_reward"]
+            extra_stats[f"z_{scenario_name}_reward"] = info["episode_return"]
+
+            approx_total_training_steps = self.training_info.get("approx_total_training_steps", 0)
+            extra_stats["z_approx_total_training_steps"] = approx_total_training_steps
+
+            if self.increase_team_spirit:
+                rew_shaping = self.get_current_reward_shaping(i)
+                rew_shaping["teamSpirit"] = min(approx_total_training_steps / self.max_team_spirit_steps, 1.0)
+                self.set_reward_shaping(rew_shaping, i)
+                extra_stats["teamSpirit"] = rew_shaping["teamSpirit"]
 
         terminated = dones
         truncated = [False] * len(dones)
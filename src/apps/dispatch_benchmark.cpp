@@ -0,0 +1,87 @@
+#include <thread>
+#include <cstdlib>
+#include <iostream>
+
+#include <util/argparse.hpp>
+#include <util/wait_policy.hpp>
+#include <util/tiny_logger.hpp>
+
+#include <env/vector_env.hpp>
+
+
+using namespace Megaverse;
+
+
+namespace
+{
+
+/**
+ * @return average wall time of one VectorEnv::step() in microseconds, with no envs to simulate and a NullRenderer,
+ * i.e. only the cost of handing tasks to the threads and waiting for them.
+ */
+double dispatchLatencyUsec(int numThreads, WaitPolicy waitPolicy, int numIterations)
+{
+    Envs envs;
+    NullRenderer renderer;
+    VectorEnv vectorEnv{envs, renderer, numThreads, 1, waitPolicy};
+
+    // warmup, let the threads start and settle
+    for (int i = 0; i < numIterations / 10; ++i)
+        vectorEnv.step();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numIterations; ++i)
+        vectorEnv.step();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    vectorEnv.close();
+
+    return std::chrono::duration<double, std::micro>(elapsed).count() / numIterations;
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+    argparse::ArgumentParser parser("dispatch_benchmark");
+    parser.add_description("Measures how long it takes VectorEnv to dispatch an empty task to all threads and wait\n"
+                           "for them to finish, for different numbers of threads and wait policies.\n"
+                           "This is the fixed per-step overhead of the thread pool, on top of the actual simulation.");
+
+    parser.add_argument("--max_threads")
+        .help("measure latency for 1..max_threads threads (including the main thread)")
+        .default_value(int(std::thread::hardware_concurrency()))
+        .scan<'i', int>();
+    parser.add_argument("--num_iterations")
+        .help("number of dispatched tasks per measurement")
+        .default_value(100000)
+        .scan<'i', int>();
+    parser.add_argument("--spin_iterations")
+        .help("Number of spin iterations before going to sleep with the hybrid wait policy")
+        .default_value(WaitPolicy{}.spinIterations)
+        .scan<'i', int>();
+
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::runtime_error &err) {
+        std::cerr << err.what() << std::endl;
+        std::cerr << parser;
+        return EXIT_FAILURE;
+    }
+
+    const auto maxThreads = std::max(1, parser.get<int>("--max_threads"));
+    const auto numIterations = std::max(1, parser.get<int>("--num_iterations"));
+    const auto spinIterations = parser.get<int>("--spin_iterations");
+
+    for (int numThreads = 1; numThreads <= maxThreads; ++numThreads) {
+        for (auto type : {WaitPolicy::Type::Spin, WaitPolicy::Type::Hybrid, WaitPolicy::Type::Sleep}) {
+            const auto latency = dispatchLatencyUsec(numThreads, WaitPolicy{type, spinIterations}, numIterations);
+
+            TLOG(INFO) << "Threads: " << numThreads << " wait policy: " << waitPolicyToString(type)
+                       << " dispatch latency: " << latency << " us";
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+#include <cstdlib>
+#include <iostream>
+
+#include <util/argparse.hpp>
+#include <util/tiny_logger.hpp>
+
+#include <env/env.hpp>
+#include <env/scenario.hpp>
+
+#include <scenarios/init.hpp>
+#include <scenarios/level_cache.hpp>
+
+
+using namespace Megaverse;
+
+
+int main(int argc, char** argv)
+{
+    argparse::ArgumentParser parser("level_cache_generator");
+    parser.add_description("Pre-generates levels of a scenario and writes them into a level cache file.\n"
+                           "Envs configured with this file (Env::setLevelCachePath(), level_cache in Python) decode\n"
+                           "random levels from it on reset instead of generating them.");
+
+    parser.add_argument("--scenario")
+        .help("name of the scenario, it has to support level caching (e.g. Obstacles* or Collect)")
+        .required();
+    parser.add_argument("--output")
+        .help("level cache file to write")
+        .required();
+    parser.add_argument("--num_levels")
+        .help("number of levels to generate")
+        .default_value(100000)
+        .scan<'i', int>();
+    parser.add_argument("--num_agents")
+        .help("number of agents the levels are generated for, envs with fewer agents can use them too")
+        .default_value(4)
+        .scan<'i', int>();
+    parser.add_argument("--seed")
+        .help("random seed, the same seed produces the same file")
+        .default_value(42)
+        .scan<'i', int>();
+
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::runtime_error &err) {
+        std::cerr << err.what() << std::endl;
+        std::cerr << parser;
+        return EXIT_FAILURE;
+    }
+
+    const auto scenarioName = parser.get<std::string>("--scenario");
+    const auto filename = parser.get<std::string>("--output");
+    const auto numLevels = std::max(1, parser.get<int>("--num_levels"));
+    const auto numAgents = std::max(1, parser.get<int>("--num_agents"));
+
+    scenariosGlobalInit();
+
+    Env env{scenarioName, numAgents};
+    env.seed(parser.get<int>("--seed"));
+
+    auto &scenario = env.getScenario();
+    auto cacheable = dynamic_cast<CacheableScenario *>(&scenario);
+    if (!cacheable) {
+        TLOG(ERROR) << "Scenario " << scenarioName << " does not support level caching";
+        return EXIT_FAILURE;
+    }
+
+    LevelCacheWriter writer{filename, scenarioName};
+    Level level;
+
+    for (int i = 0; i < numLevels; ++i) {
+        // only the layout generation, we don't need the scene graph and the physics for the levels
+        scenario.reset();
+        cacheable->saveLevel(level);
+        writer.add(level);
+
+        if ((i + 1) % 10000 == 0)
+            TLOG(INFO) << "Generated " << i + 1 << "/" << numLevels << " levels";
+    }
+
+    writer.finish();
+    TLOG(INFO) << "Wrote " << writer.size() << " levels of " << scenarioName << " to " << filename;
+
+    return EXIT_SUCCESS;
+}
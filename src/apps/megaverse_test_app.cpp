@@ -6,7 +6,9 @@
 
 #include <util/util.hpp>
 #include <util/argparse.hpp>
+#include <util/wait_policy.hpp>
 #include <util/os_utils.hpp>
+#include <util/string_utils.hpp>
 #include <util/tiny_logger.hpp>
 #include <util/tiny_profiler.hpp>
 
@@ -46,11 +48,19 @@ int mainLoop(VectorEnv &venv, EnvRenderer &renderer, bool viz, bool performanceT
     auto activeAgent = 0;
     int numFrames = 0, prevNumFrames = 0;
 
-    const auto numEnvs = int(venv.envs.size()), numAgents = venv.envs.front()->getNumAgents();
+    constexpr int reportEveryFrames = 5000;
+    int nextReportFrames = reportEveryFrames;
+
+    const auto numEnvs = int(venv.envs.size());
+
+    // envs can run different scenarios with different numbers of agents, every step simulates frameskip frames
+    int framesPerStep = 0;
+    for (const auto &e : venv.envs)
+        framesPerStep += e->getNumAgents() * e->getFrameskip();
 
     if (viz) {
         for (int envIdx = 0; envIdx < numEnvs; ++envIdx) {
-            for (int i = 0; i < numAgents; ++i) {
+            for (int i = 0; i < venv.envs[envIdx]->getNumAgents(); ++i) {
                 const auto wname = windowName(envIdx, i);
                 cv::namedWindow(wname);
                 cv::moveWindow(wname, int(W * i * 1.1), int(H * envIdx * 1.1));
@@ -146,13 +156,16 @@ int mainLoop(VectorEnv &venv, EnvRenderer &renderer, bool viz, bool performanceT
             }
         }
 
-        numFrames += numAgents * numEnvs;
+        numFrames += framesPerStep;
 
         if (numFrames > maxNumFrames) {
             shouldExit = true;
             TLOG(INFO) << "Done: " << numFrames;
             break;
-        } else if (numFrames % 5000 == 0) {
+        } else if (numFrames >= nextReportFrames) {
+            while (nextReportFrames <= numFrames)
+                nextReportFrames += reportEveryFrames;
+
             auto elapsedTimeSec = tprof().stopTimer("fps_period") / 1e6;
             tprof().startTimer("fps_period");
 
@@ -187,11 +200,16 @@ int main(int argc, char** argv)
                            "than debugging the same code through Python.\n\n"
                            "Example, render 12 agents at the same time:\n"
                            "megaverse_test_app --scenario Collect --visualize --num_envs 4 --num_simulation_threads 1 --num_agents 3 --hires\n\n"
+                           "Several scenarios can be simulated and rendered in one batch, env i runs the i-th scenario in the list (modulo its length):\n"
+                           "megaverse_test_app --scenario TowerBuilding,Collect,Sokoban --performance_test --num_envs 48\n\n"
                            "Some performance figures for future reference (on 10-core Intel i9):\n"
                            "megaverse_test_app --scenario Empty --performance_test --num_envs 64 --num_simulation_threads 1 --num_agents 1\n"
                            "yields approximately 75000 FPS\n"
                            "megaverse_test_app --scenario Collect --performance_test --num_envs 64 --num_simulation_threads 1 --num_agents 1\n"
-                           "yields approximately 27000 FPS\n");
+                           "yields approximately 27000 FPS\n\n"
+                           "To compare thread synchronization strategies, run the same benchmark with different\n"
+                           "--wait_policy (spin/sleep/hybrid) and --spin_iterations values and\n"
+                           "compare the FPS and the per-thread idle time reported at the end.\n");
 
     parser.add_argument("--num_envs")
         .help("number of parallel environments to simulate")
@@ -201,6 +219,43 @@ int main(int argc, char** argv)
         .help("number of parallel CPU threads to use for Bullet")
         .default_value(1)
         .scan<'i', int>();
+    parser.add_argument("--task_chunk_size")
+        .help("number of envs a simulation thread grabs at once from the shared pool")
+        .default_value(1)
+        .scan<'i', int>();
+    parser.add_argument("--wait_policy")
+        .help("How simulation threads wait for each other: spin, sleep, or hybrid (spin for a while, then sleep)")
+        .default_value(std::string{"hybrid"});
+    parser.add_argument("--spin_iterations")
+        .help("Number of spin iterations before going to sleep with --wait_policy hybrid")
+        .default_value(WaitPolicy{}.spinIterations)
+        .scan<'i', int>();
+    parser.add_argument("--frameskip")
+        .help("Number of frames to simulate with the same action in every step, only the last one is rendered")
+        .default_value(1)
+        .scan<'i', int>();
+    parser.add_argument("--pregenerate_episodes")
+        .help("Generate the next episode of every env in the background while the current one is running")
+        .default_value(false)
+        .implicit_value(true);
+    parser.add_argument("--merge_static_geometry")
+        .help("Build the static layout of every episode as a single compound collision object")
+        .default_value(false)
+        .implicit_value(true);
+    parser.add_argument("--full_physics_step")
+        .help("Always run the full Bullet simulation step, even in scenes without dynamic bodies")
+        .default_value(false)
+        .implicit_value(true);
+    parser.add_argument("--per_agent_readback")
+        .help("OpenGL renderer only: draw and read back every agent separately instead of using a single atlas")
+        .default_value(false)
+        .implicit_value(true);
+    parser.add_argument("--readback")
+        .help("OpenGL renderer only: blocking, pbo or pbo_delayed (observations one frame behind)")
+        .default_value(std::string{"blocking"});
+    parser.add_argument("--level_cache")
+        .help("Decode levels from this file (see level_cache_generator) instead of generating them")
+        .default_value(std::string{});
     parser.add_argument("--visualize")
         .help("Whether to render multiple environments on screen")
         .default_value(false)
@@ -228,11 +283,34 @@ int main(int argc, char** argv)
 
     parseArgs(parser, argc, argv);
 
-    const auto scenarioName = parser.get<std::string>("--scenario");
+    const auto scenarioNames = splitString(parser.get<std::string>("--scenario"), ",");
     const auto numAgents = parser.get<int>("--num_agents");
     const bool useVulkanRenderer = !parser.get<bool>("--use_opengl");
     const int numEnvs = parser.get<int>("--num_envs");  // to test vectorized env interface
     const int numSimulationThreads = parser.get<int>("--num_simulation_threads");
+    const int taskChunkSize = parser.get<int>("--task_chunk_size");
+    const bool pregenerateEpisodes = parser.get<bool>("--pregenerate_episodes");
+    const int frameskip = parser.get<int>("--frameskip");
+    const bool mergeStaticGeometry = parser.get<bool>("--merge_static_geometry");
+    const bool kinematicFastPath = !parser.get<bool>("--full_physics_step");
+    const bool perAgentReadback = parser.get<bool>("--per_agent_readback");
+    const auto levelCachePath = parser.get<std::string>("--level_cache");
+
+    bool readbackModeOk = false;
+    const auto readbackMode = readbackModeFromString(parser.get<std::string>("--readback"), readbackModeOk);
+    if (!readbackModeOk) {
+        TLOG(ERROR) << "Unknown readback mode " << parser.get<std::string>("--readback");
+        return EXIT_FAILURE;
+    }
+
+    WaitPolicy waitPolicy;
+    bool waitPolicyOk = false;
+    waitPolicy.type = waitPolicyFromString(parser.get<std::string>("--wait_policy"), waitPolicyOk);
+    waitPolicy.spinIterations = parser.get<int>("--spin_iterations");
+    if (!waitPolicyOk) {
+        TLOG(ERROR) << "Unknown wait policy " << parser.get<std::string>("--wait_policy");
+        return EXIT_FAILURE;
+    }
     const auto viz = parser.get<bool>("--visualize");
     const auto delayMs = parser.get<int>("--delay_ms");
     const auto performanceTest = parser.get<bool>("--performance_test");
@@ -245,12 +323,17 @@ int main(int argc, char** argv)
     const int maxNumFrames = performanceTest ? 400'000 : 2'000'000'000;
 
     // FloatParams params{{Str::episodeLengthSec, 0.1f}};
-    FloatParams params{{}};
+    FloatParams params;
 
     std::vector<std::unique_ptr<Env>> envs;
     for (int i = 0; i < numEnvs; ++i) {
-        envs.emplace_back(std::make_unique<Env>(scenarioName, numAgents, params));
+        envs.emplace_back(std::make_unique<Env>(scenarioNames[i % scenarioNames.size()], numAgents, params));
         envs[i]->seed(42 + i);
+        envs[i]->setEpisodePregeneration(pregenerateEpisodes);
+        envs[i]->setFrameskip(frameskip);
+        envs[i]->setStaticGeometryMerging(mergeStaticGeometry);
+        envs[i]->setKinematicFastPath(kinematicFastPath);
+        envs[i]->setLevelCachePath(levelCachePath);
     }
 
     std::unique_ptr<EnvRenderer> renderer;
@@ -262,10 +345,15 @@ int main(int argc, char** argv)
 #endif
     else {
         constexpr auto debugDraw = false;
-        renderer = std::make_unique<MagnumEnvRenderer>(envs, W, H, debugDraw);
+        auto magnumRenderer = std::make_unique<MagnumEnvRenderer>(envs, W, H, debugDraw);
+        if (!perAgentReadback)
+            magnumRenderer->enableAtlas();
+        magnumRenderer->setReadbackMode(readbackMode);
+
+        renderer = std::move(magnumRenderer);
     }
 
-    VectorEnv vectorEnv{envs, *renderer, numSimulationThreads};
+    VectorEnv vectorEnv{envs, *renderer, numSimulationThreads, taskChunkSize, waitPolicy};
     vectorEnv.reset();
 
     tprof().startTimer("loop");
@@ -275,9 +363,17 @@ int main(int argc, char** argv)
 
     vectorEnv.close();
 
+    const auto &threadStats = vectorEnv.getThreadStats();
+    for (int threadIdx = 0; threadIdx < int(threadStats.size()); ++threadIdx) {
+        const auto &stats = threadStats[threadIdx];
+        TLOG(INFO) << "Thread #" << threadIdx << " busy " << stats.busySec << "s, idle " << stats.idleSec
+                   << "s, envs processed " << stats.numEnvsProcessed;
+    }
+
     const auto fps = nFrames / (usecPassed / 1e6);
 
-    TLOG(DEBUG) << "\n\n" << fps << " FPS! " << nFrames << " frames";
+    TLOG(DEBUG) << "\n\n" << fps << " FPS! " << nFrames << " frames" << " (wait policy " << waitPolicyToString(waitPolicy.type)
+                << ", " << waitPolicy.spinIterations << " spin iterations)";
 
     return EXIT_SUCCESS;
 }
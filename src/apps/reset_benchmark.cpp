@@ -0,0 +1,148 @@
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include <LinearMath/btAlignedAllocator.h>
+
+#include <util/argparse.hpp>
+#include <util/tiny_logger.hpp>
+
+#include <env/env.hpp>
+#include <env/scenario.hpp>
+
+#include <scenarios/init.hpp>
+
+
+using namespace Megaverse;
+
+
+namespace
+{
+
+// heap allocations through operator new and Bullet's allocator
+std::atomic<size_t> numAllocations{0};
+
+void * countingMalloc(size_t size)
+{
+    ++numAllocations;
+    return std::malloc(size);
+}
+
+void countingFree(void *ptr)
+{
+    std::free(ptr);
+}
+
+struct ResetStats
+{
+    double latencyUsec = 0, allocations = 0;
+};
+
+/**
+ * @return average wall time of one Env::reset() in microseconds and the average number of heap allocations it makes.
+ * A few steps are simulated between the resets, so the physics world has contacts and overlapping pairs to clean up,
+ * like in a real episode.
+ */
+ResetStats measureReset(const std::string &scenarioName, int numAgents, bool reusePhysicsWorld, bool episodeArena, int numEpisodes, int numSteps)
+{
+    Env env{scenarioName, numAgents};
+    env.setPhysicsWorldReuse(reusePhysicsWorld);
+    env.setEpisodeArena(episodeArena);
+    env.seed(42);
+    env.reset();
+
+    std::chrono::steady_clock::duration total{};
+    size_t allocations = 0;
+
+    for (int episode = 0; episode < numEpisodes; ++episode) {
+        for (int step = 0; step < numSteps && !env.isDone(); ++step)
+            env.step();
+
+        const auto allocationsBefore = numAllocations.load();
+        const auto start = std::chrono::steady_clock::now();
+        env.reset();
+        total += std::chrono::steady_clock::now() - start;
+        allocations += numAllocations.load() - allocationsBefore;
+    }
+
+    ResetStats stats;
+    stats.latencyUsec = std::chrono::duration<double, std::micro>(total).count() / numEpisodes;
+    stats.allocations = double(allocations) / numEpisodes;
+    return stats;
+}
+
+}
+
+
+void * operator new(size_t size)
+{
+    if (auto ptr = countingMalloc(size > 0 ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr) noexcept
+{
+    countingFree(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    countingFree(ptr);
+}
+
+
+int main(int argc, char** argv)
+{
+    argparse::ArgumentParser parser("reset_benchmark");
+    parser.add_description("Measures the latency and the number of heap allocations of Env::reset() for every registered\n"
+                           "scenario: with the physics world re-created on every reset, with the world reused across\n"
+                           "episodes, and with the reused world but without the episode arena.");
+
+    parser.add_argument("--num_agents")
+        .help("number of agents per env")
+        .default_value(2)
+        .scan<'i', int>();
+    parser.add_argument("--num_episodes")
+        .help("number of resets per measurement")
+        .default_value(200)
+        .scan<'i', int>();
+    parser.add_argument("--num_steps")
+        .help("steps simulated between the resets")
+        .default_value(10)
+        .scan<'i', int>();
+
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::runtime_error &err) {
+        std::cerr << err.what() << std::endl;
+        std::cerr << parser;
+        return EXIT_FAILURE;
+    }
+
+    const auto numAgents = std::max(1, parser.get<int>("--num_agents"));
+    const auto numEpisodes = std::max(1, parser.get<int>("--num_episodes"));
+    const auto numSteps = std::max(0, parser.get<int>("--num_steps"));
+
+    // before anything is allocated by Bullet
+    btAlignedAllocSetCustom(countingMalloc, countingFree);
+
+    scenariosGlobalInit();
+
+    for (const auto &scenarioName : Scenario::registeredScenarios()) {
+        const auto recreated = measureReset(scenarioName, numAgents, false, true, numEpisodes, numSteps);
+        const auto reused = measureReset(scenarioName, numAgents, true, true, numEpisodes, numSteps);
+        const auto noArena = measureReset(scenarioName, numAgents, true, false, numEpisodes, numSteps);
+
+        TLOG(INFO) << "Scenario: " << scenarioName << " reset latency, new world: " << recreated.latencyUsec
+                   << " us, reused world: " << reused.latencyUsec << " us, reused world without arena: "
+                   << noArena.latencyUsec << " us";
+        TLOG(INFO) << "Scenario: " << scenarioName << " allocations per reset, new world: " << recreated.allocations
+                   << ", reused world: " << reused.allocations << ", reused world without arena: " << noArena.allocations;
+    }
+
+    return EXIT_SUCCESS;
+}
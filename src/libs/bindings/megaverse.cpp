@@ -1,3 +1,7 @@
+#include <set>
+#include <algorithm>
+#include <stdexcept>
+
 #include <pybind11/stl.h>
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
@@ -35,26 +39,68 @@ void setMegaverseLogLevel(int level)
 class MegaverseGym
 {
 public:
+    /**
+     * Env i runs scenarios[i % len(scenarios)] with numAgentsPerEnv[i % len(numAgentsPerEnv)] agents, so one
+     * instance with a single thread pool and a single batched renderer can simulate several different tasks.
+     */
     MegaverseGym(
-        const std::string &scenario,
+        const std::vector<std::string> &scenarios,
         int w, int h,
-        int numEnvs, int numAgentsPerEnv, int numSimulationThreads,
+        int numEnvs, const std::vector<int> &numAgentsPerEnv, int numSimulationThreads,
         bool useVulkan,
-        const std::map<std::string, float> &floatParams
+        const std::map<std::string, float> &floatParams,
+        int taskChunkSize,
+        bool pregenerateEpisodes,
+        const std::string &waitPolicyName,
+        int spinIterations,
+        int frameskip,
+        bool mergeStaticGeometry,
+        const std::string &levelCachePath,
+        const std::string &readbackModeName
     )
         : numEnvs{numEnvs}
-          , numAgentsPerEnv{numAgentsPerEnv}
           , useVulkan{useVulkan}
           , w{w}
           , h{h}
           , numSimulationThreads{numSimulationThreads}
+          , taskChunkSize{taskChunkSize}
     {
         scenariosGlobalInit();
 
-        for (int i = 0; i < numEnvs; ++i)
-            envs.emplace_back(std::make_unique<Env>(scenario, numAgentsPerEnv, floatParams));
+        bool ok = false;
+        waitPolicy.type = waitPolicyFromString(waitPolicyName, ok);
+        waitPolicy.spinIterations = spinIterations;
+        if (!ok)
+            TLOG(ERROR) << "Unknown wait policy " << waitPolicyName << ", using " << waitPolicyToString(waitPolicy.type);
+
+        readbackMode = readbackModeFromString(readbackModeName, ok);
+        if (!ok)
+            TLOG(ERROR) << "Unknown readback mode " << readbackModeName << ", using blocking readback";
+
+        TCHECK(!scenarios.empty() && !numAgentsPerEnv.empty()) << "At least one scenario and number of agents required";
+
+        // all envs get the same parameters, with several scenarios each one only takes the parameters it knows
+        const bool multipleScenarios = std::set<std::string>{scenarios.cbegin(), scenarios.cend()}.size() > 1;
+
+        for (int i = 0; i < numEnvs; ++i) {
+            const auto &scenario = scenarios[i % scenarios.size()];
+            const auto numAgents = numAgentsPerEnv[i % numAgentsPerEnv.size()];
+
+            envs.emplace_back(std::make_unique<Env>(scenario, numAgents, floatParams, multipleScenarios));
+            envs.back()->setEpisodePregeneration(pregenerateEpisodes);
+            envs.back()->setFrameskip(frameskip);
+            envs.back()->setStaticGeometryMerging(mergeStaticGeometry);
+            envs.back()->setLevelCachePath(levelCachePath);
 
-        rewards = std::vector<float>(size_t(numEnvs * numAgentsPerEnv));
+            totalNumAgents += numAgents;
+        }
+
+        for (const auto &[name, _] : floatParams) {
+            const bool known = std::any_of(envs.cbegin(), envs.cend(), [&name = name](const auto &e) { return e->hasParameter(name); });
+            TCHECK(known) << "None of the scenarios has parameter " << name;
+        }
+
+        rewards = std::vector<float>(size_t(totalNumAgents));
     }
 
     void seed(int seedValue)
@@ -68,9 +114,9 @@ public:
         }
     }
 
-    int numAgents() const
+    int numAgents(int envIdx) const
     {
-        return envs.front()->getNumAgents();
+        return envs[envIdx]->getNumAgents();
     }
 
     void reset()
@@ -82,10 +128,14 @@ public:
 #else
                 renderer = std::make_unique<V4REnvRenderer>(envs, w, h, nullptr, false);
 #endif
-            else
-                renderer = std::make_unique<MagnumEnvRenderer>(envs, w, h);
-
-            vectorEnv = std::make_unique<VectorEnv>(envs, *renderer, numSimulationThreads);
+            else {
+                auto magnumRenderer = std::make_unique<MagnumEnvRenderer>(envs, w, h);
+                magnumRenderer->enableAtlas();  // a single readback of all observations per frame
+                magnumRenderer->setReadbackMode(readbackMode);
+                renderer = std::move(magnumRenderer);
+            }
+
+            vectorEnv = std::make_unique<VectorEnv>(envs, *renderer, numSimulationThreads, taskChunkSize, waitPolicy);
         }
 
         // this also resets the main renderer
@@ -99,38 +149,62 @@ public:
 
     void setActions(int envIdx, int agentIdx, std::vector<int> actions)
     {
-        int actionIdx = 0, actionMask = 0;
-        const auto &spaces = Env::actionSpaceSizes;
+        waitStep();
 
-        for (int i = 0; i < int(actions.size()); ++i) {
-            const auto action = actions[i];
-
-            if (action > 0)
-                actionMask = actionMask | (1 << (actionIdx + action));
+        actions.resize(Env::actionSpaceSizes.size());
+        envs[envIdx]->setAction(agentIdx, Env::decodeAction(actions.data()));
+    }
 
-            const auto numNonIdleActions = spaces[i] - 1;
-            actionIdx += numNonIdleActions;
-        }
+    /**
+     * @param actions int32 array of shape [total number of agents, len(action_space_sizes)], agents of env 0 first.
+     * Decoded in the simulation threads during the next step.
+     */
+    void setActionsBatch(const py::array_t<int32_t, py::array::c_style | py::array::forcecast> &actions)
+    {
+        const auto numActionSpaces = py::ssize_t(Env::actionSpaceSizes.size());
+        if (actions.ndim() != 2 || actions.shape(0) != totalNumAgents || actions.shape(1) != numActionSpaces)
+            throw py::value_error("Expected actions of shape [" + std::to_string(totalNumAgents) + ", " + std::to_string(numActionSpaces) + "]");
 
-        envs[envIdx]->setAction(agentIdx, Action(actionMask));
+        checkReset("set_actions_batch");
+        vectorEnv->setActionsBatch(actions.data());
     }
 
     void step()
     {
+        checkReset("step");
         vectorEnv->step();
     }
 
+    /**
+     * Pipelined step: simulation of this step overlaps with rendering of the previous one in stepWait().
+     * Observations after stepWait() lag one step behind rewards and dones, see VectorEnv::stepAsync().
+     */
+    void stepAsync()
+    {
+        checkReset("step_async");
+        vectorEnv->stepAsync();
+    }
+
+    void stepWait()
+    {
+        checkReset("step_wait");
+        vectorEnv->waitStep();
+    }
+
     bool isDone(int envIdx)
     {
+        waitStep();
         return vectorEnv->done[envIdx];
     }
 
     std::vector<float> getLastRewards()
     {
+        waitStep();
+
         int i = 0;
 
         for (int envIdx = 0; envIdx < numEnvs; ++envIdx)
-            for (int agentIdx = 0; agentIdx < numAgentsPerEnv; ++agentIdx)
+            for (int agentIdx = 0; agentIdx < envs[envIdx]->getNumAgents(); ++agentIdx)
                 rewards[i++] = envs[envIdx]->getLastReward(agentIdx);
 
         return rewards;
@@ -153,6 +227,8 @@ public:
 
     void drawHires()
     {
+        waitStep();
+
         if (!hiresRenderer) {
             if (useVulkan)
 #ifdef CORRADE_TARGET_APPLE
@@ -206,21 +282,73 @@ public:
         return py::array_t<uint8_t>({renderH, renderW, 4}, obsData, py::none{});  // numpy object does not own memory
     }
 
-    float trueObjective(int envIdx, int agentIdx) const
+    float trueObjective(int envIdx, int agentIdx)
     {
+        waitStep();
         return vectorEnv->trueObjectives[envIdx][agentIdx];
     }
 
     std::map<std::string, float> getRewardShaping(int envIdx, int agentIdx)
     {
+        waitStep();
         return envs[envIdx]->getScenario().getRewardShaping(agentIdx);
     }
 
     void setRewardShaping(int envIdx, int agentIdx, const std::map<std::string, float> &rewardShaping)
     {
+        waitStep();
         envs[envIdx]->getScenario().setRewardShaping(agentIdx, rewardShaping);
     }
 
+    /**
+     * @return busy/idle time of every simulation thread accumulated since the last reset of the stats.
+     */
+    std::vector<std::map<std::string, double>> getThreadStats(bool resetStats)
+    {
+        std::vector<std::map<std::string, double>> result;
+        if (!vectorEnv)
+            return result;
+
+        for (const auto &stats : vectorEnv->getThreadStats())
+            result.push_back({{"busy_sec", stats.busySec}, {"idle_sec", stats.idleSec}, {"num_envs_processed", double(stats.numEnvsProcessed)}});
+
+        if (resetStats)
+            vectorEnv->resetThreadStats();
+
+        return result;
+    }
+
+    /**
+     * @return float32 array with one row per agent per episode finished since the last call, with columns
+     * [env_idx, agent_idx, scenario_id, episode_return, episode_length, true_objective].
+     * scenario_id indexes scenario_names(), episode_length is in simulated frames.
+     */
+    py::array_t<float> getEpisodeStats()
+    {
+        constexpr int numColumns = 6;
+        if (!vectorEnv)
+            return py::array_t<float>({py::ssize_t(0), py::ssize_t(numColumns)});
+
+        const auto &episodeStats = vectorEnv->collectEpisodeStats();
+        py::array_t<float> result({py::ssize_t(episodeStats.size()), py::ssize_t(numColumns)});
+
+        auto data = result.mutable_data();
+        for (const auto &s : episodeStats) {
+            *data++ = float(s.envIdx), *data++ = float(s.agentIdx), *data++ = float(s.scenarioId);
+            *data++ = s.episodeReturn, *data++ = float(s.length), *data++ = s.trueObjective;
+        }
+
+        return result;
+    }
+
+    std::vector<std::string> scenarioNames() const
+    {
+        if (!vectorEnv)
+            return {};
+
+        return vectorEnv->getScenarioNames();
+    }
+
     /**
      * Explicitly destroy the env and the renderer to avoid doing this when the Python object goes out-of-scope.
      */
@@ -242,9 +370,29 @@ public:
         envs.clear();
     }
 
+private:
+    /**
+     * The worker threads mutate the envs between step_async() and step_wait(), anything that touches env state
+     * calls this first.
+     */
+    void waitStep()
+    {
+        if (vectorEnv)
+            vectorEnv->waitStep();
+    }
+
+    /**
+     * The vector env is created in the first reset(), before that there is nothing to step.
+     */
+    void checkReset(const std::string &method) const
+    {
+        if (!vectorEnv)
+            throw std::runtime_error(method + "() called before reset()");
+    }
+
 private:
     Envs envs;
-    int numEnvs, numAgentsPerEnv;
+    int numEnvs, totalNumAgents = 0;
     std::vector<float> rewards;  // to avoid reallocating on every call
 
     std::unique_ptr<VectorEnv> vectorEnv;
@@ -261,6 +409,9 @@ private:
     int renderW = 768, renderH = 432;
 
     int numSimulationThreads;
+    int taskChunkSize;
+    WaitPolicy waitPolicy;
+    ReadbackMode readbackMode = ReadbackMode::Blocking;
 };
 
 
@@ -271,13 +422,29 @@ PYBIND11_MODULE(megaverse, m)
     m.def("set_megaverse_log_level", &setMegaverseLogLevel, "Megaverse Log Level (0 to disable all logs, 2 for warnings");
 
     py::class_<MegaverseGym>(m, "MegaverseGym")
-        .def(py::init<const std::string &, int, int, int, int, int, bool, const FloatParams &>())
-        .def("num_agents", &MegaverseGym::numAgents)
+        .def(
+            py::init<const std::vector<std::string> &, int, int, int, const std::vector<int> &, int, bool, const FloatParams &, int, bool, const std::string &, int, int, bool, const std::string &, const std::string &>(),
+            py::arg("scenarios"), py::arg("w"), py::arg("h"),
+            py::arg("num_envs"), py::arg("num_agents_per_env"), py::arg("num_simulation_threads"),
+            py::arg("use_vulkan"), py::arg("float_params"),
+            py::arg("task_chunk_size") = 1,
+            py::arg("pregenerate_episodes") = false,
+            py::arg("wait_policy") = "hybrid",
+            py::arg("spin_iterations") = WaitPolicy{}.spinIterations,
+            py::arg("frameskip") = 1,
+            py::arg("merge_static_geometry") = false,
+            py::arg("level_cache") = "",
+            py::arg("readback") = "blocking"
+        )
+        .def("num_agents", &MegaverseGym::numAgents, py::arg("env_idx") = 0)
         .def("action_space_sizes", &MegaverseGym::actionSpaceSizes)
         .def("seed", &MegaverseGym::seed)
         .def("reset", &MegaverseGym::reset)
         .def("set_actions", &MegaverseGym::setActions)
+        .def("set_actions_batch", &MegaverseGym::setActionsBatch)
         .def("step", &MegaverseGym::step)
+        .def("step_async", &MegaverseGym::stepAsync)
+        .def("step_wait", &MegaverseGym::stepWait)
         .def("is_done", &MegaverseGym::isDone)
         .def("get_observation", &MegaverseGym::getObservation)
         .def("get_last_rewards", &MegaverseGym::getLastRewards)
@@ -288,5 +455,8 @@ PYBIND11_MODULE(megaverse, m)
         .def("get_hires_observation", &MegaverseGym::getHiresObservation)
         .def("get_reward_shaping", &MegaverseGym::getRewardShaping)
         .def("set_reward_shaping", &MegaverseGym::setRewardShaping)
+        .def("get_episode_stats", &MegaverseGym::getEpisodeStats)
+        .def("scenario_names", &MegaverseGym::scenarioNames)
+        .def("get_thread_stats", &MegaverseGym::getThreadStats, py::arg("reset_stats") = false)
         .def("close", &MegaverseGym::close);
 }
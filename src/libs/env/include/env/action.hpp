@@ -0,0 +1,42 @@
+#pragma once
+
+
+namespace Megaverse
+{
+
+enum class Action
+{
+    Idle = 0,
+
+    Left = 1 << 1,
+    Right = 1 << 2,
+
+    Forward = 1 << 3,
+    Backward = 1 << 4,
+
+    LookLeft = 1 << 5,
+    LookRight = 1 << 6,
+
+    Jump = 1 << 7,
+    Interact = 1 << 8,
+
+    LookDown = 1 << 9,
+    LookUp = 1 << 10,
+
+    NumActions = 11,
+};
+
+
+inline Action operator|(Action a, Action b) { return Action(int(a) | int(b)); }
+
+inline Action &operator|=(Action &a, Action b) { return (Action &) ((int &) a |= int(b)); }
+
+inline Action operator&(Action a, Action b) { return Action(int(a) & int(b)); }
+
+inline Action &operator&=(Action &a, Action b) { return (Action &) ((int &) a &= int(b)); }
+
+inline Action operator~(Action a) { return Action(~int(a)); }
+
+inline bool operator!(Action a) { return a == Action::Idle; }
+
+}
@@ -10,7 +10,9 @@
 #include <util/voxel_grid.hpp>
 
 #include <env/physics.hpp>
+#include <env/snapshot.hpp>
 #include <env/voxel_state.hpp>
+#include <env/agent_controls.hpp>
 #include <env/kinematic_character_controller.hpp>
 
 
@@ -24,24 +26,8 @@ public:
 
     virtual void updateTransform() = 0;
 
-    virtual void lookLeft(float dt) = 0;
-
-    virtual void lookRight(float dt) = 0;
-
-    virtual void lookUp(float dt) = 0;
-
-    virtual void lookDown(float dt) = 0;
-
-    virtual btVector3 forwardDirection() const = 0;
-
-    virtual btVector3 strafeLeftDirection() const = 0;
-
     virtual bool onGround() const = 0;
 
-    virtual void accelerate(const btVector3 &acc, btScalar frameDuration) = 0;
-
-    virtual void jump() = 0;
-
     virtual void teleport(const btVector3 &position) = 0;
 
     virtual float getAgentHeight() = 0;
@@ -52,8 +38,12 @@ public:
 
     virtual Object3D * interactLocation() = 0;
 
-private:
-    virtual void rotateYAxis(float radians) = 0;
+    /**
+     * State of the agent not covered by its scene graph and collision object transforms, see Env::snapshot().
+     */
+    virtual void saveState(SnapshotWriter &writer) const = 0;
+
+    virtual void loadState(SnapshotReader &reader) = 0;
 
 protected:
     float verticalLookLimitRad = 0.0f;
@@ -62,11 +52,15 @@ protected:
 };
 
 
+/**
+ * Agent moved by a kinematic character controller. Actions are not applied by the agent itself, its yaw, camera pitch,
+ * velocity and ground contact live in the AgentControls block of the env, the agent is just a view into it.
+ */
 class DefaultKinematicAgent : public AbstractAgent
 {
 public:
     explicit DefaultKinematicAgent(
-        Object3D *parent, btDynamicsWorld &bWorld, const Magnum::Vector3 &startingPosition,
+        Object3D *parent, btDynamicsWorld &bWorld, AgentControls &controls, const Magnum::Vector3 &startingPosition,
         float rotationRad, float verticalLookLimitRad
     );
 
@@ -74,23 +68,7 @@ public:
 
     void updateTransform() override;
 
-    void lookLeft(float dt) override;
-
-    void lookRight(float dt) override;
-
-    void lookUp(float dt) override;
-
-    void lookDown(float dt) override;
-
-    btVector3 forwardDirection() const override;
-
-    btVector3 strafeLeftDirection() const override;
-
-    bool onGround() const override;
-
-    void accelerate(const btVector3 &acc, btScalar frameDuration) override;
-
-    void jump() override;
+    bool onGround() const override { return controls.onGround[controlIdx]; }
 
     void teleport(const btVector3 &position) override;
 
@@ -102,14 +80,15 @@ public:
 
     Object3D * interactLocation() override { return pickupSpot; }
 
-private:
-    void rotateYAxis(float radians) override;
+    void saveState(SnapshotWriter &writer) const override;
+
+    void loadState(SnapshotReader &reader) override;
 
 private:
-    static constexpr auto rotateRadians = 3.5f, rotateXRadians = 1.5f;
     static constexpr auto agentHeight = 1.75f;
 
-    float currXRotation = 0.0f;
+    AgentControls &controls;
+    int controlIdx = -1;
 
     Object3D *cameraObject;
     Magnum::SceneGraph::Camera3D *camera;
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <LinearMath/btVector3.h>
+
+#include <util/magnum.hpp>
+
+#include <env/action.hpp>
+
+
+class btCollisionObject;
+
+
+namespace Megaverse
+{
+
+class KinematicCharacterController;
+
+/**
+ * Control state of all agents of an env in structure-of-arrays layout: yaw, camera pitch, horizontal velocity and
+ * ground contact. Env::step() applies the actions of all agents in one pass over these arrays instead of calling
+ * into every agent, and only then writes the results into the Bullet objects and cameras. Agents are views into
+ * this block (see DefaultKinematicAgent).
+ */
+class AgentControls
+{
+public:
+    static constexpr float rotateRadians = 3.5f, rotateXRadians = 1.5f;
+    static constexpr float jumpSpeed = 6.2f;
+
+public:
+    /**
+     * Called when the agents of the previous episode are destroyed.
+     */
+    void clear();
+
+    /**
+     * @param ghostObject collision object of the agent, its orientation is fully defined by the yaw
+     * @param cameraOffset translation of the camera object relative to the agent, pitch is applied on top of it
+     * @return index of the agent in the arrays
+     */
+    int add(
+        btCollisionObject *ghostObject, KinematicCharacterController *controller,
+        Object3D *cameraObject, const Magnum::Vector3 &cameraOffset,
+        float yaw, float pitchLimit
+    );
+
+    int size() const { return int(yaw.size()); }
+
+    /**
+     * Integrate the actions of all agents for one frame and write yaw, pitch, velocities and jumps to the physics
+     * objects and the cameras. Called before the physics step.
+     */
+    void applyActions(const Action *actions, float frameDuration);
+
+    /**
+     * Read velocities and ground contact back from the controllers. Called after the physics step.
+     */
+    void updateFromPhysics();
+
+    /**
+     * Re-read everything, including the yaw, from the physics objects, e.g. after restoring a snapshot.
+     */
+    void sync();
+
+    /**
+     * Move the agent, resetting its orientation and velocity.
+     */
+    void teleport(int agentIdx, const btVector3 &position);
+
+    void setYaw(int agentIdx, float radians);
+
+    void setPitch(int agentIdx, float radians);
+
+public:
+    std::vector<float> yaw, pitch, pitchLimit;
+    std::vector<float> velocityX, velocityZ;
+    std::vector<uint8_t> onGround;
+
+private:
+    void applyYaw(int agentIdx);
+
+    void applyPitch(int agentIdx);
+
+private:
+    // per-frame results of the pass
+    std::vector<float> yawDelta, pitchDelta;
+    std::vector<uint8_t> jump;
+
+    std::vector<btCollisionObject *> ghostObjects;
+    std::vector<KinematicCharacterController *> controllers;
+    std::vector<Object3D *> cameraObjects;
+    std::vector<Magnum::Vector3> cameraOffsets;
+};
+
+}
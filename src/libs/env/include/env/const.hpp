@@ -1,5 +1,9 @@
 #pragma once
 
+#include <string>
+#include <vector>
+#include <utility>
+
 #include <util/util.hpp>
 #include <util/magnum.hpp>
 
@@ -9,9 +13,27 @@ namespace Megaverse
 
 using ConstStr = const char *const;
 
+/**
+ * Reward names are interned at compile time: every reward carries a fixed id that indexes the flat per-agent reward
+ * arrays of Scenario, so giving out rewards never touches a string. Ids must be unique across all scenarios
+ * (see scenarios/const.hpp). The name is only used by the dict-based reward shaping API.
+ */
+struct RewardName
+{
+    const char *name;
+    int id;
+
+    operator std::string() const { return name; }
+};
+
+/**
+ * Default values of the rewards of a scenario, later entries override earlier ones.
+ */
+using RewardDefaults = std::vector<std::pair<RewardName, float>>;
+
 namespace Str
 {
-    ConstStr teamSpirit = "teamSpirit";
+    constexpr RewardName teamSpirit{"teamSpirit", 0};
 
     ConstStr episodeLengthSec = "episodeLengthSec",
              verticalLookLimitRad = "verticalLookLimitRad",
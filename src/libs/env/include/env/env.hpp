@@ -1,17 +1,22 @@
 #pragma once
 
 #include <map>
+#include <future>
 #include <random>
 #include <vector>
 #include <algorithm>
 
+#include <Magnum/Math/Matrix4.h>
 #include <Magnum/SceneGraph/Scene.h>
 #include <Magnum/SceneGraph/SceneGraph.h>
 
 #include <util/util.hpp>
+#include <util/arena.hpp>
 
 #include <env/agent.hpp>
+#include <env/action.hpp>
 #include <env/physics.hpp>
+#include <env/snapshot.hpp>
 
 
 namespace Megaverse
@@ -19,42 +24,6 @@ namespace Megaverse
 
 class Scenario;
 
-enum class Action
-{
-    Idle = 0,
-
-    Left = 1 << 1,
-    Right = 1 << 2,
-
-    Forward = 1 << 3,
-    Backward = 1 << 4,
-
-    LookLeft = 1 << 5,
-    LookRight = 1 << 6,
-
-    Jump = 1 << 7,
-    Interact = 1 << 8,
-
-    LookDown = 1 << 9,
-    LookUp = 1 << 10,
-
-    NumActions = 11,
-};
-
-
-inline Action operator|(Action a, Action b) { return Action(int(a) | int(b)); }
-
-inline Action &operator|=(Action &a, Action b) { return (Action &) ((int &) a |= int(b)); }
-
-inline Action operator&(Action a, Action b) { return Action(int(a) & int(b)); }
-
-inline Action &operator&=(Action &a, Action b) { return (Action &) ((int &) a &= int(b)); }
-
-inline Action operator~(Action a) { return Action(~int(a)); }
-
-inline bool operator!(Action a) { return a == Action::Idle; }
-
-
 enum class DrawableType
 {
     First = 0,
@@ -71,20 +40,36 @@ enum class DrawableType
 
 struct SceneObjectInfo
 {
-    SceneObjectInfo(Object3D *objectPtr, const Magnum::Color3 &color)
+    SceneObjectInfo(Object3D *objectPtr, const Magnum::Color3 &color, bool isStatic = false)
         : objectPtr{objectPtr}
           , color{color}
+          , isStatic{isStatic}
     {
     }
 
     Object3D *objectPtr;
     Magnum::Color3 color;
+
+    // the object never moves during the episode (layout, walls, terrain), see StaticDrawable
+    bool isStatic;
+};
+
+/**
+ * Static drawable frozen in world space. When the episode is generated the env moves all drawables marked as static
+ * out of the DrawablesMap into contiguous per-type arrays of these (see Env::getStaticDrawables()), so renderers
+ * don't walk the scene graph for the layout on every frame.
+ */
+struct StaticDrawable
+{
+    Magnum::Matrix4 transformationMatrix;
+    Magnum::Color3 color;
 };
 
 
 using FloatParams = std::map<std::string, float>;
 using Agents = std::vector<AbstractAgent *>;
 using DrawablesMap = std::map<DrawableType, std::vector<SceneObjectInfo>>;
+using StaticDrawablesMap = std::map<DrawableType, std::vector<StaticDrawable>>;
 using RewardShaping = std::map<std::string, float>;
 
 class Env
@@ -106,15 +91,56 @@ public:
             collisionShapes.clear();
         }
 
+        /**
+         * Prepare the world for the next episode, keeping the world object, the pair cache and the memory pools of
+         * the dispatcher alive. The nodes of the broadphase trees are freed and re-allocated by the next episode.
+         * Must be called after the scene of the previous episode is destroyed: bodies and agents remove themselves
+         * from the world in their destructors, which also drops their overlapping pairs and contact manifolds.
+         */
+        void reset()
+        {
+            TCHECK(bWorld.getNumCollisionObjects() == 0) << "Objects of the previous episode are still in the world";
+
+            // with no proxies left this clears the dbvt trees, btDbvt::clear() frees their nodes (including the free
+            // list). The pair cache is not touched, its arrays are already empty and keep their capacity
+            bBroadphase.resetPool(&bCollisionDispatcher);
+            // reseeds the solver, so constraint ordering does not depend on previous episodes
+            bConstraintSolver.reset();
+            bWorld.resetLocalTime();
+
+            // owned by the scene and collisionShapes
+            staticLayoutBody = nullptr;
+            staticLayoutShape = nullptr;
+
+            collisionShapes.clear();
+
+            // box sizes mostly repeat between episodes, keep the shapes unless the cache grows too large
+            if (boxShapes.size() > maxCachedBoxShapes)
+                boxShapes.clear();
+        }
+
         btGhostPairCallback ghostPairCallback;
 
         btDbvtBroadphase bBroadphase;
         btSequentialImpulseConstraintSolver bConstraintSolver;
         btDefaultCollisionConfiguration bCollisionConfiguration;
         btCollisionDispatcher bCollisionDispatcher{&bCollisionConfiguration};
-        btDiscreteDynamicsWorld bWorld{&bCollisionDispatcher, &bBroadphase, &bConstraintSolver, &bCollisionConfiguration};
+        DynamicsWorld bWorld{&bCollisionDispatcher, &bBroadphase, &bConstraintSolver, &bCollisionConfiguration};
 
         std::vector<std::unique_ptr<btCollisionShape>> collisionShapes;
+
+        /**
+         * Shared shapes for static boxes, see RigidBody(Object3D *, BoxShapeCache &, btDynamicsWorld &).
+         */
+        BoxShapeCache boxShapes;
+        static constexpr size_t maxCachedBoxShapes = 4096;
+
+        /**
+         * With static geometry merging (see Env::setStaticGeometryMerging()) the static layout of the episode is a
+         * single body with a compound shape, these are nullptr until the first static box is added.
+         */
+        RigidBody *staticLayoutBody = nullptr;
+        btCompoundShape *staticLayoutShape = nullptr;
     };
 
     /**
@@ -132,7 +158,10 @@ public:
         {
         }
 
-        void reset()
+        /**
+         * @param reusePhysicsWorld empty the existing Bullet world instead of creating a new one
+         */
+        void reset(bool reusePhysicsWorld = true)
         {
             done = false;
             currEpisodeSec = 0;
@@ -142,12 +171,20 @@ public:
             std::fill(lastReward.begin(), lastReward.end(), 0.0f);
             std::fill(totalReward.begin(), totalReward.end(), 0.0f);
 
+            // destroying the scene removes all bodies and agents of the previous episode from the world
+            scene.reset();
+            // nothing references the arena anymore
+            arena.reset();
+
             scene = std::make_unique<Scene3D>();
 
             agents.clear();
+            agentControls.clear();
 
-            // completely reset the whole simulation
-            physics = std::make_unique<EnvPhysics>();
+            if (reusePhysicsWorld)
+                physics->reset();
+            else
+                physics = std::make_unique<EnvPhysics>();
         }
 
     public:
@@ -162,36 +199,139 @@ public:
         std::vector<Action> currAction;
         std::vector<float> lastReward, totalReward;
 
+        /**
+         * Add a scene object with its memory in the episode arena. Takes the parent as the first constructor
+         * argument. Use this for everything that lives until the end of the episode (layout, bodies, scenario
+         * objects), it saves a heap allocation per object and makes the teardown cheap.
+         */
+        template<typename T = Object3D, typename... Args>
+        T & addChild(Object3D &parent, Args &&...args)
+        {
+            return *new (arena) ArenaAllocated<T>{&parent, std::forward<Args>(args)...};
+        }
+
+        /**
+         * Memory of the scene objects of the episode (see addChild()), released all at once in reset().
+         * Declared before the scene, so it outlives it.
+         */
+        Arena arena;
+
         std::unique_ptr<Scene3D> scene;
 
         Agents agents;
 
+        // yaw, pitch, velocity and ground contact of the agents, updated for all agents at once in step()
+        AgentControls agentControls;
+
+        // build the static layout as one compound collision object, see Env::setStaticGeometryMerging()
+        bool mergeStaticGeometry = false;
+
         Rng rng{std::random_device{}()};
     };
 
 public:
-    explicit Env(const std::string &scenarioName, int numAgents = 2, const FloatParams& customFloatParams = FloatParams{});
+    /**
+     * @param customFloatParams overrides of the scenario parameters, resolved once here
+     * @param ignoreUnknownParams skip the parameters the scenario does not have instead of failing, useful when the
+     * same parameters are passed to envs with different scenarios
+     */
+    explicit Env(
+        const std::string &scenarioName, int numAgents = 2, const FloatParams& customFloatParams = FloatParams{},
+        bool ignoreUnknownParams = false
+    );
 
     ~Env();
 
     int getNumAgents() const { return numAgents; }
 
-    Scenario & getScenario() { return *scenario; }
+    const std::string & getScenarioName() const { return scenarioName; }
+
+    Scenario & getScenario() { return *curr->scenario; }
 
-    Scene3D & getScene() const { return *state.scene; }
+    bool hasParameter(const std::string &name) const;
 
-    Agents & getAgents() { return state.agents; }
+    Scene3D & getScene() const { return *curr->state.scene; }
 
-    EnvPhysics & getPhysics() const { return *state.physics; }
+    Agents & getAgents() { return curr->state.agents; }
+
+    EnvPhysics & getPhysics() const { return *curr->state.physics; }
 
     /**
      * Main interface between the env and the renderer.
      * @return the list of drawables for each geometric shape supported.
      */
-    const DrawablesMap & getDrawables() const { return drawables; }
+    const DrawablesMap & getDrawables() const { return curr->drawables; }
+
+    /**
+     * World transformations of the drawables that never move, computed once per episode. Not part of
+     * getDrawables(), renderers draw these directly and only the dynamic drawables through the scene graph.
+     */
+    const StaticDrawablesMap & getStaticDrawables() const { return curr->staticDrawables; }
+
+    /**
+     * Changes on every reset(), renderers can use it to tell whether per-episode data has to be re-captured.
+     */
+    uint64_t getEpisodeId() const { return curr->id; }
 
+    /**
+     * Start a new episode. With episode pregeneration enabled this normally just swaps in the episode generated in
+     * the background, see setEpisodePregeneration().
+     * Renderers have to re-register the env after this call and before the next step().
+     */
     void reset();
 
+    /**
+     * Opt-in double buffering of episodes: while the current episode runs, the next one (scenario layout, scene
+     * graph, physics world, agents and drawables) is generated by a background thread, so reset() becomes a swap.
+     * Generation of the next episode starts on the first step() after reset() and runs on TaskPool::background().
+     * It begins by tearing down the previous episode, so renderers that attach features to the scene objects must
+     * detach them from their groups in reset(). Doubles the memory footprint of the env.
+     * The same seed produces the same episodes with and without pregeneration.
+     */
+    void setEpisodePregeneration(bool enable);
+
+    bool episodePregenerationEnabled() const { return pregenerateEpisodes; }
+
+    /**
+     * By default the Bullet world is emptied and reused by the next episode. Disabling this re-creates the world
+     * (and all its internal pools) on every reset(), which is only useful to measure the difference.
+     */
+    void setPhysicsWorldReuse(bool enable) { reusePhysicsWorld = enable; }
+
+    /**
+     * Put all static layout boxes of an episode into a single compound collision shape with its own AABB tree,
+     * instead of adding one static rigid body per box. Keeps the broadphase small on large levels, so the agents'
+     * sweeps and contact queries go through one BVH. Takes effect on the next reset().
+     */
+    void setStaticGeometryMerging(bool enable) { mergeStaticGeometry = enable; }
+
+    bool staticGeometryMergingEnabled() const { return mergeStaticGeometry; }
+
+    /**
+     * Scene objects of an episode are bump-allocated from an arena that is rewound on reset() (see
+     * EnvState::addChild()). Disabling this makes every object a separate heap allocation again, which is only
+     * useful to measure the difference. Takes effect on the next reset().
+     */
+    void setEpisodeArena(bool enable) { useEpisodeArena = enable; }
+
+    /**
+     * When the current episode has no dynamic bodies (every scenario except Football), step() only moves the
+     * character controllers and updates the broadphase instead of running the full Bullet pipeline, see
+     * DynamicsWorld::stepKinematic(). Checked on every frame, so scenes with dynamic bodies are never affected.
+     * Enabled by default, disabling it is only useful to measure the difference.
+     */
+    void setKinematicFastPath(bool enable) { kinematicFastPath = enable; }
+
+    bool kinematicFastPathEnabled() const { return kinematicFastPath; }
+
+    /**
+     * Scenarios that support it decode levels from this file (see level_cache_generator) instead of generating
+     * them in reset(). Empty string means procedural generation. Takes effect on the next reset().
+     */
+    void setLevelCachePath(const std::string &path) { levelCachePath = path; }
+
+    const std::string & getLevelCachePath() const { return levelCachePath; }
+
     /**
      * Set action for the next tick.
      * @param agentIdx index of the agent for which we're setting the action
@@ -200,19 +340,32 @@ public:
     void setAction(int agentIdx, Action action);
 
     /**
-     * Advance simulation by one step.
+     * Repeat the action for this many simulated frames in every step() (action repeat). Rewards of the frames are
+     * summed, and the step ends early if the episode is done. Renderers only see the state after the last frame.
+     */
+    void setFrameskip(int numFrames);
+
+    int getFrameskip() const { return frameskip; }
+
+    /**
+     * Advance simulation by one step, i.e. by getFrameskip() frames.
      */
     void step();
 
-    bool isDone() const { return state.done; }
+    bool isDone() const { return curr->state.done; }
 
     /**
      * @param agentIdx agent for which to query the last reward
      * @return reward in the last tick
      */
-    float getLastReward(int agentIdx) const { return state.lastReward[agentIdx]; }
+    float getLastReward(int agentIdx) const { return curr->state.lastReward[agentIdx]; }
+
+    float getTotalReward(int agentIdx) const { return curr->state.totalReward[agentIdx]; }
 
-    float getTotalReward(int agentIdx) const { return state.totalReward[agentIdx]; }
+    /**
+     * @return number of frames simulated in the current episode (several per step() with frameskip)
+     */
+    int getNumFrames() const { return curr->state.numFrames; }
 
     /**
      * Unshaped reward that we're actually trying to maximize.
@@ -224,11 +377,32 @@ public:
     float remainingTimeFraction() const
     {
         const auto len = episodeLengthSec();
-        return std::max(0.0f, (len - state.currEpisodeSec) / len);
+        return std::max(0.0f, (len - curr->state.currEpisodeSec) / len);
     }
 
     void terminateEpisodeOnNextFrame();
 
+    /**
+     * Capture the state of the current episode: poses of all scene graph and collision objects, agent controller
+     * velocities, the scenario state (see Scenario::saveState()), rewards, timers and the rng.
+     * Cheap enough to be taken every step, e.g. for search or rollbacks. Reusing the same snapshot object keeps its
+     * buffer allocated. The scenario has to support snapshots (see Scenario::supportsSnapshots()).
+     */
+    void snapshot(EnvSnapshot &envSnapshot) const;
+
+    EnvSnapshot snapshot() const
+    {
+        EnvSnapshot envSnapshot;
+        snapshot(envSnapshot);
+        return envSnapshot;
+    }
+
+    /**
+     * Rewind the current episode to a snapshot taken earlier in the same episode. Snapshots are invalidated by
+     * reset(). Objects are never created or destroyed mid-episode, so restoring only overwrites their state.
+     */
+    void restore(const EnvSnapshot &envSnapshot);
+
     /**
      * We need this because of the requirements of the Vulkan renderer (materials have to be known in advance)
      */
@@ -239,28 +413,95 @@ public:
      */
     void seed(int seedValue);
 
-    Rng &getRng() { return state.rng; }
+    Rng &getRng() { return curr->state.rng; }
 
     /**
      * This is when we're running an actual realtime rendering loop with human controls.
      * Should not be used by Gym env interface.
      * @param sec actual duration of the last frame.
      */
-    void setFrameDuration(float sec) { state.lastFrameDurationSec = sec; }
+    void setFrameDuration(float sec) { curr->state.lastFrameDurationSec = sec; }
 
-    void setSimulationResolution(float sec) { state.simulationStepSeconds = sec; }
+    void setSimulationResolution(float sec) { curr->state.simulationStepSeconds = sec; }
 
 public:
     // need better mechanism for this
     static const std::vector<int> actionSpaceSizes;
 
+    /**
+     * Convert an action in the multi-discrete format (one value per action space in actionSpaceSizes) into a mask.
+     * Uses a precomputed lookup table, out-of-range values are treated as no-op.
+     * @param actions actionSpaceSizes.size() values
+     */
+    static Action decodeAction(const int *actions);
+
 private:
-    std::string scenarioName;
-    std::unique_ptr<Scenario> scenario;
+    /**
+     * Everything that lives for exactly one episode. Each episode owns its own scenario instance because scenarios
+     * keep the per-episode layout (voxel grids, platforms, etc.) as well as a reference to the state.
+     */
+    struct Episode
+    {
+        explicit Episode(int numAgents)
+        : state{numAgents}
+        {
+        }
+
+        EnvState state;
+        std::unique_ptr<Scenario> scenario;
+        DrawablesMap drawables;
+        StaticDrawablesMap staticDrawables;
+
+        // assigned when the episode starts, identifies the episode in snapshots
+        uint64_t id = 0;
+    };
+
+    std::unique_ptr<Episode> createEpisode();
+
+    /**
+     * Apply the current actions and advance physics and the scenario by one frame.
+     */
+    void simulateFrame();
+
+    /**
+     * Tear down the previous contents of the episode and generate a new one.
+     */
+    void generateEpisode(Episode &episode);
+
+    /**
+     * Move the static drawables of the episode into Episode::staticDrawables, after the scenario has added them.
+     */
+    static void freezeStaticDrawables(Episode &episode);
+
+    void startEpisodePregeneration();
 
-    EnvState state;
+    /**
+     * Block until the background generation of the next episode (if any) is finished.
+     * @return true if the next episode is ready to be swapped in.
+     */
+    bool waitForEpisodePregeneration();
+
+private:
+    std::string scenarioName;
     int numAgents;
-    DrawablesMap drawables;
+    FloatParams customFloatParams;
+    bool ignoreUnknownParams;
+
+    std::unique_ptr<Episode> curr, next;
+    uint64_t numEpisodes = 0;
+
+    // drawn from the rng of the current episode, see reset()
+    int nextEpisodeSeed = 0;
+
+    int frameskip = 1;
+
+    bool pregenerateEpisodes = false;
+    bool reusePhysicsWorld = true;
+    bool mergeStaticGeometry = false;
+    bool kinematicFastPath = true;
+    bool useEpisodeArena = true;
+    std::string levelCachePath;
+    std::future<void> nextEpisodeGenerated;
 };
 
 
@@ -16,10 +16,34 @@ public:
 
     virtual void reset(Env &env, int envIdx) = 0;
 
+    /**
+     * Register new episodes of several envs at once. Renderers can override this to amortize per-call costs
+     * (e.g. context switches) across all envs that finished their episodes during the same step.
+     * @param envIndices indices of envs (in the envs vector) that need to be reset.
+     */
+    virtual void resetMany(Envs &envs, const std::vector<int> &envIndices)
+    {
+        for (auto envIdx : envIndices)
+            reset(*envs[envIdx], envIdx);
+    }
+
     virtual void preDraw(Env &env, int envIndex) = 0;
 
     virtual void draw(Envs &envs) = 0;
 
+    /**
+     * Switch to pipelined rendering (see VectorEnv::stepAsync()): preDraw() captures everything needed to draw the env
+     * into a back buffer, and draw() only reads the front buffer, so it can run while the envs are simulating
+     * the next step.
+     * @return false if the renderer cannot draw from a snapshot, in which case nothing changes.
+     */
+    virtual bool enableSnapshots() { return false; }
+
+    /**
+     * Make the state captured by the latest preDraw() calls visible to the next draw(). No-op without snapshots.
+     */
+    virtual void swapSnapshots() {}
+
     /**
      * Query the pointer to memory holding the latest observation for an agent in an env.
      * @param envIdx env index.
@@ -31,6 +55,19 @@ public:
     virtual Overview * getOverview() = 0;
 };
 
+/**
+ * Renderer that does nothing, for tests and benchmarks of the simulation and the thread dispatch alone.
+ */
+class NullRenderer : public EnvRenderer
+{
+public:
+    void reset(Env &, int) override {}
+    void preDraw(Env &, int) override {}
+    void draw(Envs &) override {}
+    const uint8_t * getObservation(int, int) const override { return nullptr; }
+    Overview * getOverview() override { return nullptr; }
+};
+
 inline std::tuple<float, float, float, float> agentCameraParameters()
 {
     float fov = 100, near = 0.01, far = 120.0, aspectRatio = 128.0f / 72.0f;
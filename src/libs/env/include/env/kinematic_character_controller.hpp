@@ -16,6 +16,9 @@ class btPairCachingGhostObject;
 namespace Megaverse
 {
 
+class SnapshotWriter;
+class SnapshotReader;
+
 ///btKinematicCharacterController is an object that supports a sliding motion in a world.
 ///It uses a ghost object and convex sweep test to test for upcoming collisions. This is combined with discrete collision detection to recover from penetrations.
 ///Interaction between btKinematicCharacterController and dynamic rigid bodies needs to be explicity implemented by the user.
@@ -119,7 +122,20 @@ public:
 
     void setUpInterpolate(bool value);
 
-    void setAcceleration(btVector3 acc, btScalar dt);
+    /**
+     * Horizontal velocity is integrated outside of the controller, by the agent control pass (see AgentControls).
+     */
+    void setHorizontalVelocity(const btVector3 &velocity) { horizontalVelocity = velocity; }
+
+    const btVector3 & getHorizontalVelocity() const { return horizontalVelocity; }
+
+    /**
+     * Motion state that changes between frames (velocities, jump and ground contact state), see Env::snapshot().
+     * The transform of the ghost object is saved separately with the rest of the collision world.
+     */
+    void saveState(SnapshotWriter &writer) const;
+
+    void loadState(SnapshotReader &reader);
 
 protected:
     static btVector3 *getUpAxisDirections();
@@ -170,11 +186,14 @@ protected:
 
     btVector3 horizontalVelocity;
 
-    btScalar maxHorizontalSpeed = 4.5f;  // max walking speed, can be exceeded through other events (explosion, impulse)
-    btScalar maxAirSpeed = 1.0f;
-    btScalar normalDeceleration = 15.0f;
-    btScalar maxAcceleration = 35.0f + normalDeceleration, maxAirAcceleration = 3.0f;
-    btScalar exceedingSpeedLimitDeceleration = maxAcceleration * 2;
+public:
+    static constexpr btScalar maxHorizontalSpeed = 4.5f;  // max walking speed, can be exceeded through other events (explosion, impulse)
+    static constexpr btScalar maxAirSpeed = 1.0f;
+    static constexpr btScalar normalDeceleration = 15.0f;
+    static constexpr btScalar maxAcceleration = 35.0f + normalDeceleration, maxAirAcceleration = 3.0f;
+    static constexpr btScalar exceedingSpeedLimitDeceleration = maxAcceleration * 2;
+
+protected:
 
     btVector3 m_AngVel;
 
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <map>
+#include <algorithm>
+#include <tuple>
+#include <memory>
+
 #include <btBulletDynamicsCommon.h>
 
 #include <Corrade/Containers/Pointer.h>
@@ -16,40 +21,130 @@
 namespace Megaverse
 {
 
-class RigidBody : public Object3D
+/**
+ * Bullet world that can be reused for the next episode instead of being re-created.
+ */
+class DynamicsWorld : public btDiscreteDynamicsWorld
 {
 public:
-    RigidBody(Object3D *parent, Magnum::Float mass, btCollisionShape *bShape, btDynamicsWorld &bWorld)
-        : Object3D{parent}, bWorld{bWorld}
+    using btDiscreteDynamicsWorld::btDiscreteDynamicsWorld;
+
+    /**
+     * Rewind the fixed-timestep accumulator, so the next episode is stepped exactly like in a fresh world.
+     */
+    void resetLocalTime() { m_localTime = 0; }
+
+    /**
+     * Whether there is anything for the solver to do. Static bodies don't count, and the kinematic character
+     * controllers are actions, not bodies.
+     */
+    bool hasDynamicBodies() const { return m_nonStaticRigidBodies.size() > 0 || getNumConstraints() > 0; }
+
+    /**
+     * Same fixed-timestep accounting as stepSimulation(), but every substep only updates the broadphase (which keeps
+     * the pair caches of the ghost objects current) and the actions, i.e. the character controllers.
+     * Prediction, the narrowphase of the world's own pairs, islands, the constraint solver, integration and motion
+     * state synchronization are skipped, without dynamic bodies they don't change anything.
+     * @return number of substeps, like stepSimulation()
+     */
+    int stepKinematic(btScalar timeStep, int maxSubSteps, btScalar fixedTimeStep)
     {
-        // calculate inertia so the object reacts as it should with rotation and everything
-        btVector3 bInertia(0.0f, 0.0f, 0.0f);
-        if (!Magnum::Math::TypeTraits<Magnum::Float>::equals(mass, 0.0f))
-            bShape->calculateLocalInertia(mass, bInertia);
+        int numSimulationSubSteps = 0;
+
+        if (maxSubSteps) {
+            m_localTime += timeStep;
+            if (m_localTime >= fixedTimeStep) {
+                numSimulationSubSteps = int(m_localTime / fixedTimeStep);
+                m_localTime -= numSimulationSubSteps * fixedTimeStep;
+            }
+        } else {
+            // variable timestep
+            fixedTimeStep = timeStep;
+            m_localTime = timeStep;
+            numSimulationSubSteps = btFuzzyZero(timeStep) ? 0 : 1;
+            maxSubSteps = 1;
+        }
+
+        const int clampedSimulationSteps = std::min(numSimulationSubSteps, maxSubSteps);
+        for (int i = 0; i < clampedSimulationSteps; ++i) {
+            updateAabbs();
+            m_broadphasePairCache->calculateOverlappingPairs(m_dispatcher1);
+            updateActions(fixedTimeStep);
+        }
+
+        return numSimulationSubSteps;
+    }
+};
+
+/**
+ * Box shapes shared by all bodies of an env, keyed by half-extents.
+ * Bullet stores the scaling in the shape itself, so a shape from the cache must never be scaled with
+ * setLocalScaling(), bodies of a different size just use a different shape.
+ */
+class BoxShapeCache
+{
+public:
+    btBoxShape * get(const btVector3 &halfExtents)
+    {
+        auto &shape = shapes[Key{halfExtents.x(), halfExtents.y(), halfExtents.z()}];
+        if (!shape)
+            shape = std::make_unique<btBoxShape>(halfExtents);
+
+        return shape.get();
+    }
+
+    size_t size() const { return shapes.size(); }
+
+    /**
+     * Only when no bodies reference the shapes anymore.
+     */
+    void clear() { shapes.clear(); }
+
+private:
+    using Key = std::tuple<btScalar, btScalar, btScalar>;
+    std::map<Key, std::unique_ptr<btBoxShape>> shapes;
+};
 
-        // bullet rigid body setup
-        motionState = std::make_unique<Magnum::BulletIntegration::MotionState>(*this);
-        bRigidBody = std::make_unique<btRigidBody>(btRigidBody::btRigidBodyConstructionInfo{mass, &motionState->btMotionState(), bShape, bInertia});
+class RigidBody : public Object3D
+{
+public:
+    /**
+     * Box-shaped static body with a shape from the cache. syncPose() picks the shape that matches the current
+     * scale of the object.
+     */
+    RigidBody(Object3D *parent, BoxShapeCache &boxShapes, btDynamicsWorld &bWorld)
+        : RigidBody{parent, 0.0f, boxShapes.get(btVector3{1, 1, 1}), bWorld}
+    {
+        this->boxShapes = &boxShapes;
+    }
 
-        bRigidBody->setCollisionFlags(btCollisionObject::CF_STATIC_OBJECT);
+    /**
+     * The Bullet body and the motion state are members rather than separate heap objects, so a body placed in
+     * the episode arena (see Env::EnvState::addChild()) costs no allocations at all.
+     */
+    RigidBody(Object3D *parent, Magnum::Float mass, btCollisionShape *bShape, btDynamicsWorld &bWorld)
+        : Object3D{parent}
+        , bWorld{bWorld}
+        , motionState{*this}
+        , bRigidBody{constructionInfo(mass, bShape, motionState.btMotionState())}
+    {
+        bRigidBody.setCollisionFlags(btCollisionObject::CF_STATIC_OBJECT);
 
-        // bRigidBody->forceActivationState(DISABLE_DEACTIVATION);  // do we need this?
-        bWorld.addRigidBody(bRigidBody.get());
+        // bRigidBody.forceActivationState(DISABLE_DEACTIVATION);  // do we need this?
+        bWorld.addRigidBody(&bRigidBody);
     }
 
     ~RigidBody() override
     {
-        // similar to Bullet demos, delete motion state first, then remove rigid body from the world, and then delete the rigid body
-        motionState.reset();
-        bWorld.removeRigidBody(bRigidBody.get());
-        bRigidBody.reset();
+        // the rigid body and then the motion state are destroyed right after this
+        bWorld.removeRigidBody(&bRigidBody);
     }
 
-    btRigidBody &rigidBody() { return *bRigidBody; }
+    btRigidBody &rigidBody() { return bRigidBody; }
 
     bool colliding() const
     {
-        return !(bRigidBody->getCollisionFlags() & btCollisionObject::CF_NO_CONTACT_RESPONSE);
+        return !(bRigidBody.getCollisionFlags() & btCollisionObject::CF_NO_CONTACT_RESPONSE);
     }
 
     /**
@@ -69,25 +164,53 @@ public:
     void syncPose()
     {
         const auto &m = absoluteTransformationMatrix();
-        bRigidBody->setWorldTransform(btTransform{btMatrix3x3{m.rotation()}, btVector3{m.translation() + collisionOffset}});
-        bRigidBody->getCollisionShape()->setLocalScaling(btVector3{m.scaling() * collisionScale});
+        bRigidBody.setWorldTransform(btTransform{btMatrix3x3{m.rotation()}, btVector3{m.translation() + collisionOffset}});
+
+        if (boxShapes)
+            setCollisionShape(boxShapes->get(btVector3{m.scaling() * collisionScale}));
+        else
+            bRigidBody.getCollisionShape()->setLocalScaling(btVector3{m.scaling() * collisionScale});
     }
 
     void toggleCollision()
     {
-        const auto flags = bRigidBody->getCollisionFlags();
+        const auto flags = bRigidBody.getCollisionFlags();
         if (flags & btCollisionObject::CF_NO_CONTACT_RESPONSE) {
             // no collisions for this object, enabling collisions...
-            bRigidBody->setCollisionFlags(flags & ~btCollisionObject::CF_NO_CONTACT_RESPONSE);
+            bRigidBody.setCollisionFlags(flags & ~btCollisionObject::CF_NO_CONTACT_RESPONSE);
         } else {
-            bRigidBody->setCollisionFlags(flags | btCollisionObject::CF_NO_CONTACT_RESPONSE);
+            bRigidBody.setCollisionFlags(flags | btCollisionObject::CF_NO_CONTACT_RESPONSE);
         }
     }
 
+private:
+    static btRigidBody::btRigidBodyConstructionInfo constructionInfo(Magnum::Float mass, btCollisionShape *bShape, btMotionState &motionState)
+    {
+        // calculate inertia so the object reacts as it should with rotation and everything
+        btVector3 bInertia(0.0f, 0.0f, 0.0f);
+        if (!Magnum::Math::TypeTraits<Magnum::Float>::equals(mass, 0.0f))
+            bShape->calculateLocalInertia(mass, bInertia);
+
+        return btRigidBody::btRigidBodyConstructionInfo{mass, &motionState, bShape, bInertia};
+    }
+
+    void setCollisionShape(btCollisionShape *bShape)
+    {
+        if (bShape == bRigidBody.getCollisionShape())
+            return;
+
+        bRigidBody.setCollisionShape(bShape);
+
+        // cached collision algorithms and contacts were created for the old shape
+        if (auto proxy = bRigidBody.getBroadphaseHandle())
+            bWorld.getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(proxy, bWorld.getDispatcher());
+    }
+
 private:
     btDynamicsWorld &bWorld;
-    std::unique_ptr<btRigidBody> bRigidBody;
-    std::unique_ptr<Magnum::BulletIntegration::MotionState> motionState;
+    BoxShapeCache *boxShapes = nullptr;
+    Magnum::BulletIntegration::MotionState motionState;
+    btRigidBody bRigidBody;
     Magnum::Vector3 collisionScale{1, 1, 1};
     Magnum::Vector3 collisionOffset;
 };
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <map>
+#include <cmath>
 #include <memory>
 #include <string>
+#include <algorithm>
 
 #include <util/tiny_logger.hpp>
 #include <util/string_utils.hpp>
@@ -16,6 +18,47 @@ namespace Megaverse
 
 class ScenarioComponent;
 
+/**
+ * Parameters of every scenario, with their default values. Scenarios keep their own parameters in similar plain
+ * structs, the hot paths just read the fields. FloatParams are only looked at once, in setCustomParameters().
+ */
+struct ScenarioParams
+{
+    float episodeLengthSec = 60.0f;
+    float verticalLookLimitRad = 0.2f;
+    bool useUIRewardIndicators = false;
+};
+
+/**
+ * Name of a FloatParams key and the field of a parameter struct it sets, see Scenario::parameterFields().
+ * Integer and boolean fields are converted from the float value when the parameters are resolved.
+ */
+class ParamField
+{
+public:
+    ParamField(const char *name, float &field) : name{name}, floatField{&field} {}
+    ParamField(const char *name, int &field) : name{name}, intField{&field} {}
+    ParamField(const char *name, bool &field) : name{name}, boolField{&field} {}
+
+    void set(float value) const
+    {
+        if (floatField)
+            *floatField = value;
+        else if (intField)
+            *intField = int(lround(value));
+        else
+            *boolField = value > 0;
+    }
+
+public:
+    const char *name;
+
+private:
+    float *floatField = nullptr;
+    int *intField = nullptr;
+    bool *boolField = nullptr;
+};
+
 class Scenario
 {
     friend class ScenarioComponent;
@@ -30,7 +73,6 @@ public:
     : scenarioName{std::move(scenarioName)}
     , env{env}
     , envState{envState}
-    , rewardShaping(size_t(env.getNumAgents()))
     {
     }
 
@@ -95,8 +137,10 @@ public:
     {
         initializeDefaultParameters();
 
-        for (int i = 0; i < env.getNumAgents(); ++i)
-            rewardShaping[i] = {{Str::teamSpirit, 0.0f}};
+        initTeams();
+
+        // scenarios can override the default team spirit
+        initRewards({{Str::teamSpirit, 0.0f}});
 
         // initialize default reward shaping specific for this scenario
         initRewardShaping();
@@ -132,6 +176,19 @@ public:
      */
     virtual void updateUI() {}
 
+    /**
+     * Whether the env can take snapshots of this scenario's episodes, see Env::snapshot().
+     */
+    virtual bool supportsSnapshots() const { return false; }
+
+    /**
+     * The env saves the scene graph, the collision world, the agents and the rng itself. Scenarios save the rest of
+     * the state that changes during the episode: voxel grid contents, collected rewards, carried objects, etc.
+     */
+    virtual void saveState(SnapshotWriter &) const {}
+
+    virtual void loadState(SnapshotReader &) {}
+
     /**
      * @return vector with starting positions of the agents.
      */
@@ -173,25 +230,26 @@ public:
      */
     virtual float episodeLengthSec() const
     {
-        const auto episodeLengthSec = getFloatParams().at(Str::episodeLengthSec);
-        return episodeLengthSec;
+        return params.episodeLengthSec;
     }
 
     /**
      * Each environment should provide the reward shaping dictionary which allows changing rewards through API
      * (even during training)
      */
-    virtual RewardShaping defaultRewardShaping() const = 0;
+    virtual RewardDefaults defaultRewardShaping() const = 0;
 
     /**
      * Utility function, used by initRewardShaping() implementations.
-     * Replaces rewards in rewardShaping with those provided by rs (or adds them to the map if they don't exist).
+     * Sets the rewards provided by rs for all agents, adding them to the reward table if they don't exist yet.
      */
-    void initRewards(const RewardShaping &rs)
+    void initRewards(const RewardDefaults &rs)
     {
-        for (int i = 0; i < env.getNumAgents(); ++i)
-            for (const auto &[rewardName, value] : rs)
-                rewardShaping[i][rewardName] = value;
+        for (const auto &[reward, value] : rs) {
+            addReward(reward);
+            for (int i = 0; i < env.getNumAgents(); ++i)
+                rewardValues[i * numRewardIds + reward.id] = value;
+        }
     }
 
     /**
@@ -204,61 +262,115 @@ public:
 
     /**
      * @param agentIdx
-     * @return current reward shaping for the agent
+     * @return current reward shaping for the agent, as a dictionary
      */
-    virtual RewardShaping & getRewardShaping(int agentIdx) { return rewardShaping[agentIdx]; }
+    virtual RewardShaping getRewardShaping(int agentIdx) const
+    {
+        RewardShaping rs;
+        for (int id = 0; id < numRewardIds; ++id)
+            if (rewardNames[id])
+                rs[rewardNames[id]] = rewardValues[agentIdx * numRewardIds + id];
+
+        return rs;
+    }
 
     /**
      * @param agentIdx
-     * @param rs new reward shaping for the agent
+     * @param rs new values for some or all rewards of the agent, rewards not in rs keep their values.
+     * Names this scenario does not use are ignored.
+     */
+    virtual void setRewardShaping(int agentIdx, const RewardShaping &rs)
+    {
+        for (const auto &[rewardName, value] : rs) {
+            const auto it = std::find_if(rewardNames.cbegin(), rewardNames.cend(), [&rewardName](const char *name) {
+                return name && rewardName == name;
+            });
+
+            if (it == rewardNames.cend()) {
+                TLOG(WARNING) << "Scenario " << scenarioName << " does not have reward " << rewardName;
+                continue;
+            }
+
+            rewardValues[agentIdx * numRewardIds + int(it - rewardNames.cbegin())] = value;
+        }
+    }
+
+    /**
+     * Same as setRewardShaping() for all agents, without going through the dictionaries.
      */
-    virtual void setRewardShaping(int agentIdx, const RewardShaping &rs) { rewardShaping[agentIdx] = rs; }
+    void copyRewardShaping(const Scenario &other)
+    {
+        TCHECK(other.rewardNames == rewardNames) << "Reward tables of the scenarios are different";
+        rewardValues = other.rewardValues;
+    }
 
 /**
  * Other utility functions.
  */
 public:
     /**
-     * Polymorphically initialize params, if derived scenarios have custom default parameters they should override
-     * this method.
+     * The defaults are the member initializers of the parameter structs (ScenarioParams, etc.). Derived scenarios
+     * that need different defaults should override this method.
      */
-    virtual void initializeDefaultParameters()
+    virtual void initializeDefaultParameters() {}
+
+    /**
+     * Parameters that can be set by name through setCustomParameters(). Scenarios with their own parameters should
+     * override this, appending to the fields of the base class.
+     */
+    virtual std::vector<ParamField> parameterFields()
     {
-        auto &fp = floatParams;
-        fp[Str::episodeLengthSec] = 60.0f;
-        fp[Str::verticalLookLimitRad] = 0.2f;
-        fp[Str::useUIRewardIndicators] = 0.0f;
+        return {
+            {Str::episodeLengthSec, params.episodeLengthSec},
+            {Str::verticalLookLimitRad, params.verticalLookLimitRad},
+            {Str::useUIRewardIndicators, params.useUIRewardIndicators},
+        };
     }
 
-    virtual const FloatParams & getFloatParams() const { return floatParams; }
+    bool hasParameter(const std::string &name)
+    {
+        const auto fields = parameterFields();
+        return std::any_of(fields.cbegin(), fields.cend(), [&name](const ParamField &f) { return name == f.name; });
+    }
 
     /**
-     * This default behavior should typically be sufficient, although can also be overridden.
+     * Resolve the custom parameters into the parameter structs, called once after init().
+     * @param ignoreUnknown skip the keys this scenario does not have, otherwise they are a fatal error
      */
-    virtual void setCustomParameters(const FloatParams &customFloatParams)
+    virtual void setCustomParameters(const FloatParams &customFloatParams, bool ignoreUnknown = false)
     {
-        for (const auto &[k, v] : customFloatParams)
-            floatParams[k] = v;
+        const auto fields = parameterFields();
+
+        for (const auto &[k, v] : customFloatParams) {
+            const auto it = std::find_if(fields.cbegin(), fields.cend(), [&k = k](const ParamField &f) { return k == f.name; });
+
+            if (it != fields.cend())
+                it->set(v);
+            else if (!ignoreUnknown)
+                TLOG(FATAL) << "Scenario " << scenarioName << " does not have parameter " << k;
+        }
     }
 
 protected:
     /**
-     * @return reward for a specific string key for a particular agent in the environment
+     * @return reward value for a particular agent in the environment
      * Since different agents can be controlled by different policies, they can also have different reward shaping
      * associated with them (e.g. when we're doing PBT).
-     * Therefore we need a separate rewardShaping dictionary for every agent.
+     * Therefore every agent has its own row in the reward table.
      */
-    virtual float getReward(const std::string &rewardName, int agentIdx) const
+    virtual float getReward(const RewardName &reward, int agentIdx) const
     {
-        return rewardShaping[agentIdx].at(rewardName);
+        TCHECK(reward.id >= 0 && reward.id < numRewardIds && rewardNames[reward.id])
+            << "Reward " << reward.name << " is not in the reward table of scenario " << scenarioName;
+        return rewardValues[agentIdx * numRewardIds + reward.id];
     }
 
     /**
      * Reward agent individually, do not reward other agents even if teamSpirit > 0
      */
-    virtual void rewardAgent(const std::string &rewardName, int agentIdx, float multiplier)
+    virtual void rewardAgent(const RewardName &reward, int agentIdx, float multiplier)
     {
-        envState.lastReward[agentIdx] += getReward(rewardName, agentIdx) * multiplier;
+        envState.lastReward[agentIdx] += getReward(reward, agentIdx) * multiplier;
     }
 
     /**
@@ -271,39 +383,76 @@ protected:
 
     /**
      * Which team the agent belongs to. By default all agents are on the same team.
+     * Queried once in init(), see initTeams().
      */
     virtual int teamAffinity(int /*agentIdx*/) const { return 0; }
 
-    virtual int teamSize(const int agentIdx) const {
-        const int currTeam = teamAffinity(agentIdx);
-        int size = 0;
-        for (int i = 0; i < env.getNumAgents(); ++i)
-            size += currTeam == teamAffinity(i) ? 1 : 0;
-
-        return size;
-    }
+    int teamSize(int agentIdx) const { return teamSizes[agentIdx]; }
 
     /**
      * Reward all agents, taking teamSpirit into account. Can be useful for collaborative tasks.
      * TeamSpirit is expected to be in [0, 1] range.
      * The agent whose action was rewarded gets the full reward. Other agents get teamSpirit * reward.
      */
-    virtual void rewardTeam(const std::string &rewardName, int agentIdx, float multiplier)
+    virtual void rewardTeam(const RewardName &reward, int agentIdx, float multiplier)
     {
-        const auto currTeam = teamAffinity(agentIdx);
-        rewardAgent(rewardName, agentIdx, multiplier * (1 - teamSpirit(agentIdx)));
+        const auto currTeam = teams[agentIdx];
+        rewardAgent(reward, agentIdx, multiplier * (1 - teamSpirit(agentIdx)));
+
         for (int i = 0; i < env.getNumAgents(); ++i)
-            if (teamAffinity(i) == currTeam)
-                envState.lastReward[i] += getReward(rewardName, i) * teamSpirit(i) * multiplier / teamSize(i);
+            if (teams[i] == currTeam)
+                envState.lastReward[i] += getReward(reward, i) * teamSpirit(i) * multiplier / float(teamSizes[i]);
     }
 
     /**
      * Reward all agents equally, regardless of team spirit.
      */
-    virtual void rewardAll(const std::string &rewardName, float multiplier)
+    virtual void rewardAll(const RewardName &reward, float multiplier)
     {
         for (int i = 0; i < env.getNumAgents(); ++i)
-            rewardAgent(rewardName, i, multiplier);
+            rewardAgent(reward, i, multiplier);
+    }
+
+private:
+    /**
+     * Cache the team of every agent and the sizes of the teams.
+     */
+    void initTeams()
+    {
+        const auto numAgents = env.getNumAgents();
+        teams.resize(size_t(numAgents)), teamSizes.assign(size_t(numAgents), 0);
+
+        for (int i = 0; i < numAgents; ++i)
+            teams[i] = teamAffinity(i);
+
+        for (int i = 0; i < numAgents; ++i)
+            teamSizes[i] = int(std::count(teams.cbegin(), teams.cend(), teams[i]));
+    }
+
+    /**
+     * Make room for the reward in the table, rewards are only added during init().
+     */
+    void addReward(const RewardName &reward)
+    {
+        TCHECK(reward.id >= 0) << "Invalid id of reward " << reward.name;
+
+        if (reward.id >= numRewardIds) {
+            const auto numAgents = env.getNumAgents();
+            const int newNumRewardIds = reward.id + 1;
+
+            std::vector<float> newValues(size_t(numAgents * newNumRewardIds), 0.0f);
+            for (int i = 0; i < numAgents; ++i)
+                std::copy_n(rewardValues.data() + i * numRewardIds, numRewardIds, newValues.data() + i * newNumRewardIds);
+
+            rewardValues.swap(newValues);
+            rewardNames.resize(size_t(newNumRewardIds), nullptr);
+            numRewardIds = newNumRewardIds;
+        }
+
+        TCHECK(!rewardNames[reward.id] || std::string{rewardNames[reward.id]} == reward.name)
+            << "Rewards " << rewardNames[reward.id] << " and " << reward.name << " have the same id " << reward.id;
+
+        rewardNames[reward.id] = reward.name;
     }
 
 private:
@@ -316,8 +465,8 @@ private:
 protected:
     std::string scenarioName;
 
-    // default values, can be overridden in ctor
-    FloatParams floatParams;
+    // see initializeDefaultParameters() and setCustomParameters()
+    ScenarioParams params;
 
     /**
      * Adds an optional mechanism for components to access each other.
@@ -328,8 +477,16 @@ protected:
     Env &env;
     Env::EnvState &envState;
 
-    // reward shaping schemes for every agent in the env
-    std::vector<RewardShaping> rewardShaping;
+private:
+    // reward names by RewardName::id, nullptr for ids this scenario doesn't use
+    std::vector<const char *> rewardNames;
+    int numRewardIds = 0;
+
+    // reward shaping schemes for every agent in the env, rewardValues[agentIdx * numRewardIds + RewardName::id]
+    std::vector<float> rewardValues;
+
+    // team of every agent and the size of that team, see teamAffinity()
+    std::vector<int> teams, teamSizes;
 };
 
 }
@@ -25,6 +25,13 @@ public:
 
     virtual void step(Env &, Env::EnvState &) {}
 
+    /**
+     * Mutable per-episode state of the component, see Scenario::saveState().
+     */
+    virtual void saveState(SnapshotWriter &) const {}
+
+    virtual void loadState(SnapshotReader &) {}
+
 protected:
     /**
      * When needed a component can access the parent scenario.
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+#include <LinearMath/btTransform.h>
+
+#include <util/tiny_logger.hpp>
+
+
+namespace Megaverse
+{
+
+/**
+ * Mid-episode state of an env, see Env::snapshot(). Plain bytes, so snapshots can be copied, stored and compared
+ * freely. Reusing the same object for consecutive snapshots keeps the buffer allocated.
+ */
+struct EnvSnapshot
+{
+    // snapshots can only be restored into the episode they were taken from
+    uint64_t episodeId = 0;
+
+    std::vector<char> data;
+
+    size_t size() const { return data.size(); }
+};
+
+/**
+ * Appends trivially copyable values and arrays of them to a snapshot buffer.
+ * Bullet math types have user-defined copy constructors and are written component by component.
+ */
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(std::vector<char> &buffer)
+    : buffer{buffer}
+    {
+    }
+
+    template<typename T>
+    void write(const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be written to snapshots");
+        append(&value, sizeof(T));
+    }
+
+    template<typename T>
+    void writeArray(const T *values, size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be written to snapshots");
+        append(values, count * sizeof(T));
+    }
+
+    template<typename T>
+    void write(const std::vector<T> &values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be written to snapshots");
+        write(uint64_t(values.size()));
+        append(values.data(), values.size() * sizeof(T));
+    }
+
+    void write(const std::vector<bool> &values)
+    {
+        write(uint64_t(values.size()));
+        for (bool v : values)
+            write(uint8_t(v));
+    }
+
+    void write(const btVector3 &v)
+    {
+        write(v.x()), write(v.y()), write(v.z());
+    }
+
+    void write(const btQuaternion &q)
+    {
+        write(q.x()), write(q.y()), write(q.z()), write(q.w());
+    }
+
+    void write(const btTransform &t)
+    {
+        for (int row = 0; row < 3; ++row)
+            write(t.getBasis()[row]);
+        write(t.getOrigin());
+    }
+
+private:
+    void append(const void *data, size_t size)
+    {
+        const auto offset = buffer.size();
+        buffer.resize(offset + size);
+        if (size > 0)
+            memcpy(buffer.data() + offset, data, size);
+    }
+
+private:
+    std::vector<char> &buffer;
+};
+
+/**
+ * Reads the values back in the order they were written by SnapshotWriter. Copying the reader is a cheap way to
+ * read a section twice.
+ */
+class SnapshotReader
+{
+public:
+    explicit SnapshotReader(const std::vector<char> &buffer)
+    : ptr{buffer.data()}
+    , end{buffer.data() + buffer.size()}
+    {
+    }
+
+    template<typename T>
+    void read(T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be read from snapshots");
+        consume(&value, sizeof(T));
+    }
+
+    template<typename T>
+    T read()
+    {
+        T value;
+        read(value);
+        return value;
+    }
+
+    template<typename T>
+    void readArray(T *values, size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be read from snapshots");
+        consume(values, count * sizeof(T));
+    }
+
+    template<typename T>
+    void read(std::vector<T> &values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be read from snapshots");
+        values.resize(size_t(read<uint64_t>()));
+        consume(values.data(), values.size() * sizeof(T));
+    }
+
+    void read(std::vector<bool> &values)
+    {
+        values.resize(size_t(read<uint64_t>()));
+        for (size_t i = 0; i < values.size(); ++i)
+            values[i] = read<uint8_t>();
+    }
+
+    void read(btVector3 &v)
+    {
+        const auto x = read<btScalar>(), y = read<btScalar>(), z = read<btScalar>();
+        v.setValue(x, y, z);
+    }
+
+    void read(btQuaternion &q)
+    {
+        const auto x = read<btScalar>(), y = read<btScalar>(), z = read<btScalar>(), w = read<btScalar>();
+        q.setValue(x, y, z, w);
+    }
+
+    void read(btTransform &t)
+    {
+        for (int row = 0; row < 3; ++row)
+            read(t.getBasis()[row]);
+        read(t.getOrigin());
+    }
+
+    bool finished() const { return ptr == end; }
+
+private:
+    void consume(void *data, size_t size)
+    {
+        TCHECK(size_t(end - ptr) >= size) << "Snapshot is truncated";
+        if (size > 0)
+            memcpy(data, ptr, size);
+        ptr += size;
+    }
+
+private:
+    const char *ptr, *end;
+};
+
+}
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <thread>
-#include <condition_variable>
+
+#include <util/wait_policy.hpp>
+#include <util/spsc_ring.hpp>
 
 #include <env/env.hpp>
 #include <env/env_renderer.hpp>
@@ -22,20 +25,98 @@ public:
         TERMINATE,
     };
 
+    /**
+     * Scheduling statistics for one thread of the pool, accumulated over all executed tasks.
+     * Idle time is the part of the task wall time the thread spent waiting for other threads to finish.
+     */
+    struct ThreadStats
+    {
+        double busySec = 0, idleSec = 0;
+        long long numEnvsProcessed = 0;
+    };
+
+    /**
+     * Result of one agent in a finished episode.
+     */
+    struct EpisodeStats
+    {
+        int envIdx = 0, agentIdx = 0;
+        int scenarioId = 0;  // index in getScenarioNames()
+        float episodeReturn = 0, trueObjective = 0;
+        int length = 0;  // number of simulated frames
+    };
+
+    // number of finished episodes remembered per env between calls to collectEpisodeStats()
+    static constexpr int episodeStatsCapacity = 16;
+
 public:
-    explicit VectorEnv(Envs &envs, EnvRenderer &renderer, int numThreads);
+    /**
+     * @param numThreads total number of simulation threads, including the calling (main) thread.
+     * @param chunkSize threads grab envs from a shared atomic counter in chunks of this size. Small chunks balance
+     * the load better (one slow env does not stall the whole batch), large chunks reduce the contention on the counter.
+     * @param waitPolicy how the worker threads wait for new tasks and the main thread waits for the workers to finish.
+     */
+    explicit VectorEnv(Envs &envs, EnvRenderer &renderer, int numThreads, int chunkSize = 1, WaitPolicy waitPolicy = WaitPolicy{});
 
     void step();
 
+    /**
+     * Pipelined version of step(). Starts simulating the next step in the worker threads and returns right away.
+     * waitStep() renders the previous step while the simulation is running, and then waits for it to finish.
+     * Thus after waitStep() the done flags, rewards and true objectives belong to the new step, while the
+     * observations lag one step behind.
+     * Renderers that cannot draw from a snapshot (see EnvRenderer::enableSnapshots()) fall back to a synchronous
+     * step(), in which case waitStep() does nothing.
+     */
+    void stepAsync();
+
+    void waitStep();
+
     void reset();
 
+    /**
+     * Set actions of all agents in all envs at once. The actions are decoded (see Env::decodeAction()) in the
+     * worker threads at the beginning of the next step, overriding the actions set with Env::setAction().
+     * @param actions Env::actionSpaceSizes.size() values per agent, agents of env 0 first, then env 1, etc.
+     * The values are copied, the memory can be reused right away.
+     */
+    void setActionsBatch(const int *actions);
+
     void close();
 
+    /**
+     * Like everything else that reads the state of the envs, waits for a step started with stepAsync() to finish.
+     */
+    const std::vector<ThreadStats> & getThreadStats();
+
+    void resetThreadStats();
+
+    /**
+     * Stats of all episodes finished since the last call, ordered by env. Per env only the last
+     * episodeStatsCapacity episodes are kept, older unread ones are dropped.
+     * The reference is valid until the next call.
+     */
+    const std::vector<EpisodeStats> & collectEpisodeStats();
+
+    /**
+     * Distinct scenarios of the envs in order of appearance, EpisodeStats::scenarioId indexes this list.
+     */
+    const std::vector<std::string> & getScenarioNames() const { return scenarioNames; }
+
 private:
     void taskFunc(Task task, int threadIdx);
 
+    void startTask(Task task);
+
+    void finishTask(Task task);
+
     void executeTask(Task task);
 
+    /**
+     * Collect done flags after the STEP task and register the new episodes with the renderer.
+     */
+    void processFinishedEpisodes();
+
     void stepEnv(int envIdx);
 
     void resetEnv(int envIdx);
@@ -48,12 +129,69 @@ public:
     std::vector<std::vector<float>> trueObjectives;
 
 private:
-    int numThreads{}, envsPerThread{};
+    int numThreads{}, chunkSize{};
     std::vector<std::thread> backgroundThreads;
-    std::vector<Task> currTasks;
-    std::condition_variable cvTask;
-    std::mutex mutex;
-    std::atomic<int> numReady = 0;
+
+    /**
+     * Dispatch state of one background thread. Every worker has its own command ring (produced by the main thread)
+     * and its own wake-up event, so dispatching a task does not touch anything shared by all threads.
+     */
+    struct alignas(64) Worker
+    {
+        explicit Worker(WaitPolicy waitPolicy)
+        : commandReady{waitPolicy}
+        {
+        }
+
+        SpscRing<Task, 4> commands;
+        SpinSleepEvent commandReady;
+
+        // number of commands this worker has finished, written only by the worker
+        alignas(64) std::atomic<long long> completedEpoch = 0;
+    };
+
+    // workers[i] belongs to thread i + 1, thread 0 is the main thread
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // number of tasks dispatched so far, only touched by the main thread
+    long long dispatchEpoch = 0;
+    SpinSleepEvent workersDone;
+
+    // written by the worker threads during the STEP task, one byte per env to avoid races on std::vector<bool>
+    std::vector<uint8_t> episodeFinished;
+    std::vector<int> resetEnvIndices;
+
+    // flat index of the first agent of every env, envs can have different numbers of agents
+    std::vector<int> firstAgentIdx;
+    std::vector<int> actionsBatch;
+    bool actionsBatchPending = false;
+
+    std::vector<std::string> scenarioNames;
+    std::vector<int> envScenarioIds;
+
+    // ring buffer of finished episodes (numAgents entries per episode) for every env, written by the thread that
+    // stepped the env, read by the main thread between tasks
+    struct EpisodeStatsRing
+    {
+        std::vector<EpisodeStats> entries;
+        long long numWritten = 0, numRead = 0;
+    };
+
+    std::vector<EpisodeStatsRing> episodeStatsRings;
+    std::vector<EpisodeStats> collectedEpisodeStats;
+
+    // index of the next env to be picked up by any thread during the current task
+    std::atomic<int> nextEnvIdx = 0;
+
+    bool snapshotsRequested = false, snapshotsEnabled = false;
+    bool stepInFlight = false;
+
+    std::chrono::steady_clock::time_point taskStart;
+
+    // time each thread spent working on the last task, written by the thread itself before it signals completion
+    std::vector<std::chrono::steady_clock::duration> lastBusyTime;
+    std::vector<int> lastNumEnvsProcessed;
+    std::vector<ThreadStats> threadStats;
 };
 
-}
\ No newline at end of file
+}
@@ -22,16 +22,14 @@ AbstractAgent::AbstractAgent(Object3D *parent, btDynamicsWorld &bWorld, float ve
 }
 
 
-DefaultKinematicAgent::DefaultKinematicAgent(Object3D *parent, btDynamicsWorld &bWorld, const Vector3 &startingPosition,
-                                             float rotationRad, float verticalLookLimitRad)
+DefaultKinematicAgent::DefaultKinematicAgent(Object3D *parent, btDynamicsWorld &bWorld, AgentControls &controls,
+                                             const Vector3 &startingPosition, float rotationRad, float verticalLookLimitRad)
 : AbstractAgent(parent, bWorld, verticalLookLimitRad)
+, controls{controls}
 , cameraObject{&(addChild<Object3D>())}
 , camera{&(cameraObject->addFeature<SceneGraph::Camera3D>())}
 , pickupSpot{&(cameraObject->addChild<Object3D>())}
 {
-    // cameraObject.rotateY(0.0_degf);
-    cameraObject->translate(Magnum::Vector3{0, 0.41f, 0});
-
     auto [fov, near, far, aspectRatio] = agentCameraParameters();
     camera->setAspectRatioPolicy(SceneGraph::AspectRatioPolicy::Extend)
            .setProjectionMatrix(Matrix4::perspectiveProjection(Deg(fov), aspectRatio, near, far))
@@ -62,6 +60,9 @@ DefaultKinematicAgent::DefaultKinematicAgent(Object3D *parent, btDynamicsWorld &
 //    bWorld.addCollisionObject(&ghostObject, btBroadphaseProxy::CharacterFilter, btBroadphaseProxy::StaticFilter | btBroadphaseProxy::CharacterFilter);
     bWorld.addCollisionObject(&ghostObject, btBroadphaseProxy::CharacterFilter | btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::StaticFilter | btBroadphaseProxy::CharacterFilter | btBroadphaseProxy::DefaultFilter);
     bWorld.addAction(bCharacter.get());
+
+    // also places the camera
+    controlIdx = controls.add(&ghostObject, bCharacter.get(), cameraObject, Vector3{0, 0.41f, 0}, rotationRad, verticalLookLimitRad);
 }
 
 DefaultKinematicAgent::~DefaultKinematicAgent()
@@ -97,75 +98,20 @@ void DefaultKinematicAgent::updateTransform()
     this->resetTransformation().rotate(Rad{rotation}, normalizedAxis).translate(position);
 }
 
-void DefaultKinematicAgent::lookLeft(float dt)
-{
-    rotateYAxis(rotateRadians * dt);
-}
-
-void DefaultKinematicAgent::lookRight(float dt)
-{
-    rotateYAxis(-rotateRadians * dt);
-}
-
-void DefaultKinematicAgent::lookUp(float dt)
-{
-    cameraObject->rotateXLocal(Math::Rad<float>(-currXRotation));
-    currXRotation += rotateXRadians * dt;
-    currXRotation = std::min(verticalLookLimitRad, currXRotation);
-    cameraObject->rotateXLocal(Math::Rad<float>(currXRotation));
-}
-
-void DefaultKinematicAgent::lookDown(float dt)
-{
-    cameraObject->rotateXLocal(Math::Rad<float>(-currXRotation));
-    // this is a hack, in the beginning of training the agents really love to look at the sky and can't learn anything
-    // by making looking down easier than up I hope to prevent this
-    currXRotation -= rotateXRadians * dt * 1.1f;
-    currXRotation = std::max(-verticalLookLimitRad, currXRotation);
-    cameraObject->rotateXLocal(Math::Rad<float>(currXRotation));
-}
-
-void DefaultKinematicAgent::rotateYAxis(float radians)
-{
-    btMatrix3x3 orn = ghostObject.getWorldTransform().getBasis();
-    orn *= btMatrix3x3(btQuaternion(btVector3(0, 1, 0), radians));
-    ghostObject.getWorldTransform ().setBasis(orn);
-}
-
-btVector3 DefaultKinematicAgent::forwardDirection() const
-{
-    auto xform = ghostObject.getWorldTransform ();
-    btVector3 forwardDir = xform.getBasis()[2];
-    forwardDir.setZ(-forwardDir.z());
-    // TLOG(INFO) << "forwardDir: " << forwardDir.x() << " " << forwardDir.y() << " " << forwardDir.z();
-    return forwardDir.normalize();
-}
-
-btVector3 DefaultKinematicAgent::strafeLeftDirection() const
-{
-    auto xform = ghostObject.getWorldTransform ();
-    btVector3 sidewaysDir = xform.getBasis()[0];
-    sidewaysDir.setX(-sidewaysDir.x());
-    return sidewaysDir.normalize();
-}
-
-void DefaultKinematicAgent::accelerate(const btVector3 &acc, btScalar frameDuration)
-{
-    bCharacter->setAcceleration(acc, frameDuration);
-}
-
-void DefaultKinematicAgent::jump()
+void DefaultKinematicAgent::teleport(const btVector3 &position)
 {
-    if (onGround())
-        bCharacter->jump(btVector3(0, 6.2, 0));
+    controls.teleport(controlIdx, position);
 }
 
-void DefaultKinematicAgent::teleport(const btVector3 &position)
+void DefaultKinematicAgent::saveState(SnapshotWriter &writer) const
 {
-    bCharacter->warp(position);
+    // yaw and velocity are restored from the physics state, see AgentControls::sync()
+    writer.write(controls.pitch[controlIdx]);
+    bCharacter->saveState(writer);
 }
 
-bool DefaultKinematicAgent::onGround() const
+void DefaultKinematicAgent::loadState(SnapshotReader &reader)
 {
-    return bCharacter->onGround();
+    controls.setPitch(controlIdx, reader.read<float>());
+    bCharacter->loadState(reader);
 }
@@ -0,0 +1,182 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <btBulletCollisionCommon.h>
+
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Matrix4.h>
+
+#include <env/agent_controls.hpp>
+#include <env/kinematic_character_controller.hpp>
+
+
+using namespace Magnum;
+
+using namespace Megaverse;
+
+
+void AgentControls::clear()
+{
+    yaw.clear(), pitch.clear(), pitchLimit.clear();
+    velocityX.clear(), velocityZ.clear();
+    onGround.clear();
+
+    yawDelta.clear(), pitchDelta.clear();
+    jump.clear();
+
+    ghostObjects.clear(), controllers.clear(), cameraObjects.clear(), cameraOffsets.clear();
+}
+
+int AgentControls::add(
+    btCollisionObject *ghostObject, KinematicCharacterController *controller,
+    Object3D *cameraObject, const Vector3 &cameraOffset,
+    float initialYaw, float initialPitchLimit
+)
+{
+    yaw.emplace_back(initialYaw), pitch.emplace_back(0.0f), pitchLimit.emplace_back(initialPitchLimit);
+
+    const auto &velocity = controller->getHorizontalVelocity();
+    velocityX.emplace_back(velocity.x()), velocityZ.emplace_back(velocity.z());
+    onGround.emplace_back(controller->onGround());
+
+    yawDelta.emplace_back(0.0f), pitchDelta.emplace_back(0.0f);
+    jump.emplace_back(0);
+
+    ghostObjects.emplace_back(ghostObject), controllers.emplace_back(controller);
+    cameraObjects.emplace_back(cameraObject), cameraOffsets.emplace_back(cameraOffset);
+
+    const int agentIdx = size() - 1;
+    applyYaw(agentIdx), applyPitch(agentIdx);
+
+    return agentIdx;
+}
+
+void AgentControls::applyActions(const Action *actions, float dt)
+{
+    using Controller = KinematicCharacterController;
+
+    const int n = size();
+    const float epsilon = std::numeric_limits<float>::epsilon();
+
+    // arithmetic only, over contiguous arrays
+    for (int i = 0; i < n; ++i) {
+        const auto a = int(actions[i]);
+        const auto pressed = [a](Action action) { return float((a & int(action)) != 0); };
+
+        // if both actions of a pair are set the first one wins
+        const float forward = pressed(Action::Forward), left = pressed(Action::Left);
+        const float walk = forward - (1 - forward) * pressed(Action::Backward);
+        const float strafe = left - (1 - left) * pressed(Action::Right);
+
+        const float lookLeft = pressed(Action::LookLeft), lookUp = pressed(Action::LookUp);
+        const float turn = lookLeft - (1 - lookLeft) * pressed(Action::LookRight);
+        // this is a hack, in the beginning of training the agents really love to look at the sky and can't learn
+        // anything, by making looking down easier than up I hope to prevent this
+        const float tilt = lookUp - (1 - lookUp) * 1.1f * pressed(Action::LookDown);
+
+        // forward and strafe directions of the agent before this frame's rotation
+        const float sinYaw = std::sin(yaw[i]), cosYaw = std::cos(yaw[i]);
+        const float ax = -walk * sinYaw - strafe * cosYaw;
+        const float az = -walk * cosYaw + strafe * sinYaw;
+
+        const bool grounded = onGround[i];
+
+        // we always apply max possible acceleration in the desired direction
+        const float accLength = std::sqrt(ax * ax + az * az);
+        const float maxAcceleration = grounded ? Controller::maxAcceleration : Controller::maxAirAcceleration;
+        const float accScale = accLength >= epsilon ? maxAcceleration * dt / accLength : 0.0f;
+
+        const float vx = velocityX[i], vz = velocityZ[i];
+        const float newVx = vx + ax * accScale, newVz = vz + az * accScale;
+        const float speed = std::sqrt(vx * vx + vz * vz), newSpeed = std::sqrt(newVx * newVx + newVz * newVz);
+
+        // on the ground we decelerate when exceeding the max walking speed, but never below it
+        const float dv = Controller::exceedingSpeedLimitDeceleration * dt;
+        const float groundScale = newSpeed > Controller::maxHorizontalSpeed ? std::max(newSpeed - dv, Controller::maxHorizontalSpeed) / newSpeed : 1.0f;
+
+        // in the air there is no friction or deceleration, but acceleration can't exceed the max air speed
+        const bool airAccelerate = newSpeed <= Controller::maxAirSpeed || newSpeed < speed;
+
+        const float scale = grounded ? groundScale : 1.0f;
+        const bool keepVelocity = !grounded && !airAccelerate;
+        velocityX[i] = keepVelocity ? vx : newVx * scale;
+        velocityZ[i] = keepVelocity ? vz : newVz * scale;
+
+        yawDelta[i] = turn * rotateRadians * dt;
+        yaw[i] += yawDelta[i];
+
+        const float newPitch = std::clamp(pitch[i] + tilt * rotateXRadians * dt, -pitchLimit[i], pitchLimit[i]);
+        pitchDelta[i] = newPitch - pitch[i];
+        pitch[i] = newPitch;
+
+        jump[i] = pressed(Action::Jump) > 0 && grounded;
+    }
+
+    // write the results, only touching what actually changed
+    for (int i = 0; i < n; ++i) {
+        if (yawDelta[i] != 0)
+            applyYaw(i);
+        if (pitchDelta[i] != 0)
+            applyPitch(i);
+
+        controllers[i]->setHorizontalVelocity(btVector3{velocityX[i], 0, velocityZ[i]});
+
+        if (jump[i])
+            controllers[i]->jump(btVector3{0, jumpSpeed, 0});
+    }
+}
+
+void AgentControls::updateFromPhysics()
+{
+    for (int i = 0; i < size(); ++i) {
+        const auto &velocity = controllers[i]->getHorizontalVelocity();
+        velocityX[i] = velocity.x(), velocityZ[i] = velocity.z();
+        onGround[i] = controllers[i]->onGround();
+    }
+}
+
+void AgentControls::sync()
+{
+    for (int i = 0; i < size(); ++i) {
+        // the basis is a rotation around the Y axis, its first row is (cos(yaw), 0, sin(yaw))
+        const auto &basis = ghostObjects[i]->getWorldTransform().getBasis();
+        yaw[i] = std::atan2(basis[0].z(), basis[0].x());
+    }
+
+    updateFromPhysics();
+}
+
+void AgentControls::teleport(int agentIdx, const btVector3 &position)
+{
+    // resets the orientation and the velocities
+    controllers[agentIdx]->warp(position);
+
+    yaw[agentIdx] = 0;
+    velocityX[agentIdx] = velocityZ[agentIdx] = 0;
+    onGround[agentIdx] = controllers[agentIdx]->onGround();
+}
+
+void AgentControls::setYaw(int agentIdx, float radians)
+{
+    yaw[agentIdx] = radians;
+    applyYaw(agentIdx);
+}
+
+void AgentControls::setPitch(int agentIdx, float radians)
+{
+    pitch[agentIdx] = std::clamp(radians, -pitchLimit[agentIdx], pitchLimit[agentIdx]);
+    applyPitch(agentIdx);
+}
+
+void AgentControls::applyYaw(int agentIdx)
+{
+    auto &transform = ghostObjects[agentIdx]->getWorldTransform();
+    transform.setBasis(btMatrix3x3{btQuaternion{btVector3{0, 1, 0}, yaw[agentIdx]}});
+}
+
+void AgentControls::applyPitch(int agentIdx)
+{
+    const auto transformation = Matrix4::translation(cameraOffsets[agentIdx]) * Matrix4::rotationX(Rad{pitch[agentIdx]});
+    cameraObjects[agentIdx]->setTransformation(transformation);
+}
@@ -2,6 +2,7 @@
 
 #include <Magnum/SceneGraph/Camera.h>
 
+#include <util/task_pool.hpp>
 #include <util/tiny_logger.hpp>
 
 #include <env/env.hpp>
@@ -32,98 +33,337 @@ LookUp = 1 << 10,
 **/
 const std::vector<int> Env::actionSpaceSizes = {3, 3, 3, 2, 2, 3};
 
+namespace
+{
+
+/**
+ * Action mask bits for every value of every action space. Value 0 is always a no-op, values 1..n-1 of the i-th space
+ * map to consecutive bits after the bits used by the previous spaces.
+ */
+std::vector<std::vector<Action>> makeActionLookupTable()
+{
+    std::vector<std::vector<Action>> table;
+    int actionIdx = 0;
+
+    for (auto spaceSize : Env::actionSpaceSizes) {
+        std::vector<Action> spaceActions{Action::Idle};
+        for (int action = 1; action < spaceSize; ++action)
+            spaceActions.emplace_back(Action(1 << (actionIdx + action)));
+
+        table.emplace_back(std::move(spaceActions));
+        actionIdx += spaceSize - 1;
+    }
+
+    return table;
+}
+
+// defined after actionSpaceSizes in the same translation unit, so it is initialized after it
+const std::vector<std::vector<Action>> actionLookupTable = makeActionLookupTable();
+
+/**
+ * Depth-first: object, its parent and local transformation. The list is terminated by nullptr.
+ */
+void saveSceneGraph(SnapshotWriter &writer, Object3D &parent)
+{
+    for (auto child = parent.children().first(); child; child = child->nextSibling()) {
+        writer.write(child), writer.write(&parent);
+        writer.writeArray(child->transformationMatrix().data(), 16);
+
+        saveSceneGraph(writer, *child);
+    }
+}
+
+void loadSceneGraph(SnapshotReader &reader)
+{
+    while (auto object = reader.read<Object3D *>()) {
+        auto parent = reader.read<Object3D *>();
+
+        Matrix4 transformation;
+        reader.readArray(transformation.data(), 16);
+
+        // objects carried by the agents change parents
+        if (object->parent() != parent)
+            object->setParent(parent);
+
+        object->setTransformation(transformation);
+    }
+}
+
+void saveCollisionWorld(SnapshotWriter &writer, const btCollisionWorld &bWorld)
+{
+    const auto &objects = bWorld.getCollisionObjectArray();
+    writer.write(objects.size());
+
+    for (int i = 0; i < objects.size(); ++i) {
+        const auto obj = objects[i];
+        writer.write(obj), writer.write(obj->getCollisionShape());
+        writer.write(obj->getWorldTransform());
+        writer.write(obj->getCollisionFlags()), writer.write(obj->getActivationState());
+
+        if (const auto body = btRigidBody::upcast(obj))
+            writer.write(body->getLinearVelocity()), writer.write(body->getAngularVelocity());
+    }
+}
+
+void loadCollisionWorld(SnapshotReader &reader, btCollisionWorld &bWorld)
+{
+    auto &objects = bWorld.getCollisionObjectArray();
+    TCHECK(reader.read<int>() == objects.size()) << "Collision objects were added or removed since the snapshot";
+
+    auto pairCache = bWorld.getBroadphase()->getOverlappingPairCache();
+
+    btTransform transform;
+    btVector3 linearVelocity, angularVelocity;
+
+    for (int i = 0; i < objects.size(); ++i) {
+        const auto obj = objects[i];
+        TCHECK(reader.read<btCollisionObject *>() == obj) << "Collision objects were added or removed since the snapshot";
+
+        const auto shape = reader.read<btCollisionShape *>();
+        reader.read(transform);
+        const auto collisionFlags = reader.read<int>(), activationState = reader.read<int>();
+
+        const bool moved = !(transform == obj->getWorldTransform()) || shape != obj->getCollisionShape();
+
+        obj->setCollisionShape(shape);
+        obj->setWorldTransform(transform);
+        obj->setInterpolationWorldTransform(transform);
+        obj->setCollisionFlags(collisionFlags);
+        obj->forceActivationState(activationState);
+
+        if (auto body = btRigidBody::upcast(obj)) {
+            reader.read(linearVelocity), reader.read(angularVelocity);
+            body->setLinearVelocity(linearVelocity), body->setAngularVelocity(angularVelocity);
+            body->setInterpolationLinearVelocity(linearVelocity), body->setInterpolationAngularVelocity(angularVelocity);
+        }
+
+        if (moved) {
+            // most objects don't move, only these need new AABBs and fresh contacts
+            bWorld.updateSingleAabb(obj);
+            if (auto proxy = obj->getBroadphaseHandle())
+                pairCache->cleanProxyFromPairs(proxy, bWorld.getDispatcher());
+        }
+    }
+}
+
+}
 
-Env::Env(const std::string &scenarioName, int numAgents, const FloatParams& customFloatParams)
+Action Env::decodeAction(const int *actions)
+{
+    auto action = Action::Idle;
+
+    for (size_t i = 0; i < actionLookupTable.size(); ++i) {
+        const auto &spaceActions = actionLookupTable[i];
+        if (unsigned(actions[i]) < spaceActions.size())
+            action |= spaceActions[actions[i]];
+    }
+
+    return action;
+}
+
+
+Env::Env(const std::string &scenarioName, int numAgents, const FloatParams& customFloatParams, bool ignoreUnknownParams)
     : scenarioName{scenarioName}
-    , state{numAgents}
     , numAgents{numAgents}
+    , customFloatParams{customFloatParams}
+    , ignoreUnknownParams{ignoreUnknownParams}
 {
-    scenario = Scenario::create(scenarioName, *this, state);
-    scenario->init();
-    scenario->setCustomParameters(customFloatParams);
+    curr = createEpisode();
+    nextEpisodeSeed = randRange(0, 1 << 30, curr->state.rng);
+}
+
+Env::~Env()
+{
+    // the background thread references the episode, make sure it is done before we destroy anything
+    waitForEpisodePregeneration();
+}
+
+std::unique_ptr<Env::Episode> Env::createEpisode()
+{
+    auto episode = std::make_unique<Episode>(numAgents);
+
+    episode->scenario = Scenario::create(scenarioName, *this, episode->state);
+    episode->scenario->init();
+    episode->scenario->setCustomParameters(customFloatParams, ignoreUnknownParams);
 
     // empty list of drawables for each supported drawable type
-    for (int drawableType = int(DrawableType::First); drawableType < int(DrawableType::NumTypes); ++drawableType)
-        drawables[DrawableType(drawableType)] = std::vector<SceneObjectInfo>{};
+    for (int drawableType = int(DrawableType::First); drawableType < int(DrawableType::NumTypes); ++drawableType) {
+        episode->drawables[DrawableType(drawableType)] = std::vector<SceneObjectInfo>{};
+        episode->staticDrawables[DrawableType(drawableType)] = std::vector<StaticDrawable>{};
+    }
+
+    return episode;
 }
 
-Env::~Env() = default;
+bool Env::hasParameter(const std::string &name) const
+{
+    return curr->scenario->hasParameter(name);
+}
 
 void Env::seed(int seedValue)
 {
-    state.rng.seed((unsigned long)seedValue);
+    // the pregenerated episode was seeded from the old rng state, discard it
+    waitForEpisodePregeneration();
+    nextEpisodeGenerated = std::future<void>{};
+
+    curr->state.rng.seed((unsigned long)seedValue);
+    nextEpisodeSeed = randRange(0, 1 << 30, curr->state.rng);
 }
 
-void Env::reset()
+void Env::setEpisodePregeneration(bool enable)
 {
-    state.reset();
+    waitForEpisodePregeneration();
+    nextEpisodeGenerated = std::future<void>{};
 
-    auto seed = randRange(0, 1 << 30, state.rng);
-    state.rng.seed((unsigned long)seed);
-    // TLOG(INFO) << "Using seed " << seed;
+    pregenerateEpisodes = enable;
+
+    if (pregenerateEpisodes && !next)
+        next = createEpisode();
+    else if (!pregenerateEpisodes)
+        next.reset();
+}
+
+void Env::generateEpisode(Episode &episode)
+{
+    auto &state = episode.state;
+    state.reset(reusePhysicsWorld);
+    state.mergeStaticGeometry = mergeStaticGeometry;
+    state.arena.setBumpAllocation(useEpisodeArena);
 
     // remove dangling pointers from the previous episode
-    for (int drawableType = int(DrawableType::First); drawableType < int(DrawableType::NumTypes); ++drawableType)
-        drawables[DrawableType(drawableType)].clear();
+    for (int drawableType = int(DrawableType::First); drawableType < int(DrawableType::NumTypes); ++drawableType) {
+        episode.drawables[DrawableType(drawableType)].clear();
+        episode.staticDrawables[DrawableType(drawableType)].clear();
+    }
 
+    auto &scenario = episode.scenario;
     scenario->reset();
 
     scenario->spawnAgents(state.agents);
 
-    scenario->addEpisodeDrawables(drawables);
-    scenario->addEpisodeAgentsDrawables(drawables);
-    scenario->addUIDrawables(drawables);
+    scenario->addEpisodeDrawables(episode.drawables);
+    scenario->addEpisodeAgentsDrawables(episode.drawables);
+    scenario->addUIDrawables(episode.drawables);
+
+    freezeStaticDrawables(episode);
+}
+
+void Env::freezeStaticDrawables(Episode &episode)
+{
+    for (auto &[drawableType, sceneObjects] : episode.drawables) {
+        auto &staticDrawables = episode.staticDrawables[drawableType];
+
+        const auto firstStatic = std::stable_partition(sceneObjects.begin(), sceneObjects.end(), [](const SceneObjectInfo &info) {
+            return !info.isStatic;
+        });
+
+        for (auto it = firstStatic; it != sceneObjects.end(); ++it)
+            staticDrawables.push_back({it->objectPtr->absoluteTransformationMatrix(), it->color});
+
+        sceneObjects.erase(firstStatic, sceneObjects.end());
+    }
+}
+
+void Env::startEpisodePregeneration()
+{
+    next->state.rng.seed((unsigned long)nextEpisodeSeed);
+
+    // a small shared pool rather than a thread per env, thousands of envs would oversubscribe the simulation threads
+    nextEpisodeGenerated = TaskPool::background().submit([this] { generateEpisode(*next); });
+}
+
+bool Env::waitForEpisodePregeneration()
+{
+    if (!nextEpisodeGenerated.valid())
+        return false;
+
+    nextEpisodeGenerated.wait();
+    return true;
+}
+
+void Env::reset()
+{
+    if (pregenerateEpisodes && waitForEpisodePregeneration()) {
+        // rethrows exceptions from the background thread, if any
+        nextEpisodeGenerated.get();
+
+        // these can be changed through the API while the episode runs, carry them over to the new episode
+        next->state.lastFrameDurationSec = curr->state.lastFrameDurationSec;
+        next->state.simulationStepSeconds = curr->state.simulationStepSeconds;
+        next->scenario->copyRewardShaping(*curr->scenario);
+
+        // the previous episode will be destroyed by the background thread when we start generating the next one
+        std::swap(curr, next);
+    } else {
+        curr->state.rng.seed((unsigned long)nextEpisodeSeed);
+        generateEpisode(*curr);
+    }
+
+    curr->id = ++numEpisodes;
+
+    // right after generation, so the rng is in the same state whether the episode was pregenerated or not,
+    // and the same seed gives the same episodes in both modes
+    nextEpisodeSeed = randRange(0, 1 << 30, curr->state.rng);
 }
 
 void Env::setAction(int agentIdx, Action action)
 {
-    state.currAction[agentIdx] = action;
+    curr->state.currAction[agentIdx] = action;
+}
+
+void Env::setFrameskip(int numFrames)
+{
+    frameskip = std::max(1, numFrames);
 }
 
 void Env::step()
 {
-    std::fill(state.lastReward.begin(), state.lastReward.end(), 0.0f);
+    if (pregenerateEpisodes && !nextEpisodeGenerated.valid())
+        startEpisodePregeneration();
 
-    const auto lastFrameDurationSec = state.lastFrameDurationSec;
+    auto &state = curr->state;
 
-    for (int i = 0; i < numAgents; ++i) {
-        const auto a = state.currAction[i];
-        const auto &agent = state.agents[i];
+    // rewards of all simulated frames add up
+    std::fill(state.lastReward.begin(), state.lastReward.end(), 0.0f);
 
-        auto acceleration = btVector3{0, 0, 0};
+    for (int frame = 0; frame < frameskip; ++frame) {
+        simulateFrame();
 
-        if (!!(a & Action::Forward))
-            acceleration += agent->forwardDirection();
-        else if (!!(a & Action::Backward))
-            acceleration -= agent->forwardDirection();
+        if (state.done)
+            break;
+    }
 
-        if (!!(a & Action::Left))
-            acceleration += agent->strafeLeftDirection();
-        else if (!!(a & Action::Right))
-            acceleration -= agent->strafeLeftDirection();
+    // clear the actions
+    for (int i = 0; i < numAgents; ++i)
+        state.currAction[i] = Action::Idle;
 
-        if (!!(a & Action::LookLeft))
-            agent->lookLeft(lastFrameDurationSec);
-        else if (!!(a & Action::LookRight))
-            agent->lookRight(lastFrameDurationSec);
+    for (int i = 0; i < int(state.agents.size()); ++i) {
+        state.totalReward[i] += state.lastReward[i];
 
-        if (!!(a & Action::LookUp))
-            agent->lookUp(lastFrameDurationSec);
-        else if (!!(a & Action::LookDown))
-            agent->lookDown(lastFrameDurationSec);
+//        if (fabs(state.lastReward[i]) > SIMD_EPSILON)
+//            TLOG(INFO) << "Last reward for agent #" << i << ":  " << state.lastReward[i] << ", total reward:  " << state.totalReward[i];
+    }
+}
 
-        // if (acceleration.length() > 0)
-        //    TLOG(INFO) << "acc direction: " << acceleration.x() << " " << acceleration.y() << " " << acceleration.z();
+void Env::simulateFrame()
+{
+    auto &state = curr->state;
+    auto &scenario = curr->scenario;
 
-        agent->accelerate(acceleration, lastFrameDurationSec);
+    const auto lastFrameDurationSec = state.lastFrameDurationSec;
 
-        if (!!(a & Action::Jump))
-            agent->jump();
-    }
+    TCHECK(state.agentControls.size() == numAgents);
+    state.agentControls.applyActions(state.currAction.data(), lastFrameDurationSec);
 
     scenario->preStep();
 
-    state.physics->bWorld.stepSimulation(lastFrameDurationSec, 1, state.simulationStepSeconds);
+    auto &bWorld = state.physics->bWorld;
+    if (kinematicFastPath && !bWorld.hasDynamicBodies())
+        bWorld.stepKinematic(lastFrameDurationSec, 1, state.simulationStepSeconds);
+    else
+        bWorld.stepSimulation(lastFrameDurationSec, 1, state.simulationStepSeconds);
+
+    state.agentControls.updateFromPhysics();
 
     for (auto agent : state.agents)
         agent->updateTransform();
@@ -137,36 +377,78 @@ void Env::step()
     if (state.currEpisodeSec >= episodeLengthSec())
         state.done = true;
 
-    // clear the actions
-    for (int i = 0; i < numAgents; ++i)
-        state.currAction[i] = Action::Idle;
-
-    for (int i = 0; i < int(state.agents.size()); ++i) {
-        state.totalReward[i] += state.lastReward[i];
-
-//        if (fabs(state.lastReward[i]) > SIMD_EPSILON)
-//            TLOG(INFO) << "Last reward for agent #" << i << ":  " << state.lastReward[i] << ", total reward:  " << state.totalReward[i];
-    }
-
     ++state.numFrames;
 }
 
 std::vector<Magnum::Color3> Env::getPalette() const
 {
-    return scenario->getPalette();
+    return curr->scenario->getPalette();
 }
 
 float Env::episodeLengthSec() const
 {
-    return scenario->episodeLengthSec();
+    return curr->scenario->episodeLengthSec();
 }
 
 float Env::trueObjective(int agentIdx) const
 {
-    return scenario->trueObjective(agentIdx);
+    return curr->scenario->trueObjective(agentIdx);
 }
 
 void Env::terminateEpisodeOnNextFrame()
 {
-    scenario->doneWithTimer(0.001f);
+    curr->scenario->doneWithTimer(0.001f);
+}
+
+void Env::snapshot(EnvSnapshot &envSnapshot) const
+{
+    const auto &state = curr->state;
+    const auto &scenario = *curr->scenario;
+
+    if (!scenario.supportsSnapshots())
+        TLOG(FATAL) << "Scenario " << scenarioName << " does not support snapshots";
+
+    envSnapshot.episodeId = curr->id;
+    envSnapshot.data.clear();
+
+    SnapshotWriter writer{envSnapshot.data};
+
+    writer.write(state.done), writer.write(state.numFrames), writer.write(state.currEpisodeSec);
+    writer.write(state.currAction), writer.write(state.lastReward), writer.write(state.totalReward);
+    writer.write(state.rng);
+
+    saveSceneGraph(writer, *state.scene);
+    writer.write(static_cast<Object3D *>(nullptr));
+
+    saveCollisionWorld(writer, state.physics->bWorld);
+
+    for (auto agent : state.agents)
+        agent->saveState(writer);
+
+    scenario.saveState(writer);
+}
+
+void Env::restore(const EnvSnapshot &envSnapshot)
+{
+    TCHECK(envSnapshot.episodeId == curr->id) << "Snapshot of episode " << envSnapshot.episodeId << " cannot be restored in episode " << curr->id;
+
+    auto &state = curr->state;
+
+    SnapshotReader reader{envSnapshot.data};
+
+    reader.read(state.done), reader.read(state.numFrames), reader.read(state.currEpisodeSec);
+    reader.read(state.currAction), reader.read(state.lastReward), reader.read(state.totalReward);
+    reader.read(state.rng);
+
+    loadSceneGraph(reader);
+    loadCollisionWorld(reader, state.physics->bWorld);
+
+    for (auto agent : state.agents)
+        agent->loadState(reader);
+
+    state.agentControls.sync();
+
+    curr->scenario->loadState(reader);
+
+    TCHECK(reader.finished()) << "Snapshot was not fully consumed";
 }
@@ -7,6 +7,7 @@
 #include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
 #include "LinearMath/btDefaultMotionState.h"
 
+#include <env/snapshot.hpp>
 #include <env/kinematic_character_controller.hpp>
 #include <util/tiny_logger.hpp>
 
@@ -746,47 +747,32 @@ btQuaternion KinematicCharacterController::getRotation(btVector3& v0, btVector3&
     return shortestArcQuatNormalize2(v0, v1);
 }
 
-/**
- * @param acc acceleration vector
- * @param dt time passed since last frame in seconds
- */
-void KinematicCharacterController::setAcceleration(btVector3 acc, btScalar dt)
+void KinematicCharacterController::saveState(SnapshotWriter &writer) const
 {
-    const bool isOnGround = onGround();
+    writer.write(m_verticalVelocity), writer.write(m_verticalOffset);
+    writer.write(horizontalVelocity);
+    writer.write(m_AngVel);
 
-    const auto accelerationMagnitude = acc.length();
-    const auto currMaxAcceleration = isOnGround ? maxAcceleration : maxAirAcceleration;
+    writer.write(m_jumpSpeed), writer.write(m_jumpAxis), writer.write(m_jumpPosition);
 
-    // we always apply max possible acceleration in the desired direction
-    if (!acc.fuzzyZero())
-        acc *= currMaxAcceleration / accelerationMagnitude;
+    writer.write(m_currentPosition), writer.write(m_targetPosition), writer.write(m_currentStepOffset);
+    writer.write(m_currentOrientation), writer.write(m_targetOrientation);
 
-    if (isOnGround) {
-        // apply acceleration to change velocity
-        horizontalVelocity += acc * dt;
-        const auto currHorizontalSpeed = horizontalVelocity.length();
+    writer.write(m_touchingContact), writer.write(m_touchingNormal);
+    writer.write(m_wasOnGround), writer.write(m_wasJumping);
+}
 
-        // check if we exceed the max speed, decelerate if necessary
-        if (currHorizontalSpeed > maxHorizontalSpeed) {
-            const auto dv = exceedingSpeedLimitDeceleration * dt;
+void KinematicCharacterController::loadState(SnapshotReader &reader)
+{
+    reader.read(m_verticalVelocity), reader.read(m_verticalOffset);
+    reader.read(horizontalVelocity);
+    reader.read(m_AngVel);
 
-            if (currHorizontalSpeed - dv > maxHorizontalSpeed) {
-                // after applying large deceleration we're still traveling too fast - just subtract the deceleration
-                horizontalVelocity *= (currHorizontalSpeed - dv) / currHorizontalSpeed;
-            } else {
-                // if we just subtract deceleration we'd be traveling too slow
-                // decelerate to max walking speed
-                horizontalVelocity *= maxHorizontalSpeed / currHorizontalSpeed;
-            }
-        }
-    } else {
-        // in the air
-
-        // there is no friction or deceleration
-        const auto currHorizontalSpeed = horizontalVelocity.length();
-        const auto newHorizontalVelocity = horizontalVelocity + acc * dt;
-        const auto newHorizontalSpeed = newHorizontalVelocity.length();
-        if (newHorizontalSpeed <= maxAirSpeed || newHorizontalSpeed < currHorizontalSpeed)
-            horizontalVelocity = newHorizontalVelocity;
-    }
+    reader.read(m_jumpSpeed), reader.read(m_jumpAxis), reader.read(m_jumpPosition);
+
+    reader.read(m_currentPosition), reader.read(m_targetPosition), reader.read(m_currentStepOffset);
+    reader.read(m_currentOrientation), reader.read(m_targetOrientation);
+
+    reader.read(m_touchingContact), reader.read(m_touchingNormal);
+    reader.read(m_wasOnGround), reader.read(m_wasJumping);
 }
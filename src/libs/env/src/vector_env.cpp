@@ -1,34 +1,42 @@
+#include <numeric>
+#include <algorithm>
+
 #include <env/vector_env.hpp>
 
 using namespace Megaverse;
 
 
-VectorEnv::VectorEnv(std::vector<std::unique_ptr<Env>> &envs, EnvRenderer &renderer, int numThreads)
+VectorEnv::VectorEnv(std::vector<std::unique_ptr<Env>> &envs, EnvRenderer &renderer, int numThreads, int chunkSize, WaitPolicy waitPolicy)
 : envs(envs)
 , renderer(renderer)
 , numThreads{numThreads}  // use master threads as one of the threads
+, chunkSize{std::max(1, chunkSize)}
+, workersDone{waitPolicy}
 {
     const int numEnvs = int(envs.size());
-    envsPerThread = (numEnvs / numThreads) + (numEnvs % numThreads != 0);
 
-    currTasks = std::vector<Task>(size_t(numThreads), Task::IDLE);
+    for (int i = 1; i < numThreads; ++i)
+        workers.emplace_back(std::make_unique<Worker>(waitPolicy));
+
+    lastBusyTime = std::vector<std::chrono::steady_clock::duration>(size_t(numThreads));
+    lastNumEnvsProcessed = std::vector<int>(size_t(numThreads));
+    threadStats = std::vector<ThreadStats>(size_t(numThreads));
 
     for (int i = 1; i < numThreads; ++i) {
         std::thread t{
             [this](int threadIdx) {
+                auto &worker = *workers[threadIdx - 1];
 
                 while (true) {
-                    std::unique_lock<std::mutex> lock{mutex};
-
-                    while (currTasks[threadIdx] == Task::IDLE)
-                        cvTask.wait(lock);
+                    worker.commandReady.wait([&worker] { return !worker.commands.empty(); });
 
-                    const auto task = currTasks[threadIdx];
-                    currTasks[threadIdx] = Task::IDLE;
-                    lock.unlock();
+                    auto task = Task::IDLE;
+                    worker.commands.pop(task);
 
                     taskFunc(task, threadIdx);
-                    ++numReady;
+
+                    worker.completedEpoch.store(worker.completedEpoch.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+                    workersDone.notifyAll();
 
                     if (task == Task::TERMINATE)
                         break;
@@ -40,15 +48,65 @@ VectorEnv::VectorEnv(std::vector<std::unique_ptr<Env>> &envs, EnvRenderer &rende
     }
 
     done = std::vector<bool>(envs.size());
+    episodeFinished = std::vector<uint8_t>(envs.size());
     trueObjectives = std::vector<std::vector<float>>(envs.size());
-    for (int envIdx = 0; envIdx < numEnvs; ++envIdx)
-        trueObjectives[envIdx] = std::vector<float>(envs[envIdx]->getNumAgents());
+
+    episodeStatsRings = std::vector<EpisodeStatsRing>(envs.size());
+
+    int totalNumAgents = 0;
+    for (int envIdx = 0; envIdx < numEnvs; ++envIdx) {
+        const auto &env = *envs[envIdx];
+
+        trueObjectives[envIdx] = std::vector<float>(env.getNumAgents());
+        firstAgentIdx.emplace_back(totalNumAgents);
+        totalNumAgents += env.getNumAgents();
+
+        const auto it = std::find(scenarioNames.begin(), scenarioNames.end(), env.getScenarioName());
+        envScenarioIds.emplace_back(int(it - scenarioNames.begin()));
+        if (it == scenarioNames.end())
+            scenarioNames.emplace_back(env.getScenarioName());
+
+        episodeStatsRings[envIdx].entries.resize(size_t(episodeStatsCapacity * env.getNumAgents()));
+    }
+
+    actionsBatch = std::vector<int>(size_t(totalNumAgents) * Env::actionSpaceSizes.size());
 }
 
 void VectorEnv::stepEnv(int envIdx)
 {
-    envs[envIdx]->step();
-    renderer.preDraw(*envs[envIdx], envIdx);
+    auto &env = *envs[envIdx];
+
+    if (actionsBatchPending) {
+        const auto actionSize = int(Env::actionSpaceSizes.size());
+        const int *envActions = actionsBatch.data() + firstAgentIdx[envIdx] * actionSize;
+
+        for (int agentIdx = 0; agentIdx < env.getNumAgents(); ++agentIdx)
+            env.setAction(agentIdx, Env::decodeAction(envActions + agentIdx * actionSize));
+    }
+
+    env.step();
+
+    episodeFinished[envIdx] = env.isDone();
+
+    if (episodeFinished[envIdx]) {
+        auto &ring = episodeStatsRings[envIdx];
+
+        for (int agentIdx = 0; agentIdx < env.getNumAgents(); ++agentIdx) {
+            trueObjectives[envIdx][agentIdx] = env.trueObjective(agentIdx);
+
+            auto &stats = ring.entries[ring.numWritten++ % ring.entries.size()];
+            stats.envIdx = envIdx, stats.agentIdx = agentIdx, stats.scenarioId = envScenarioIds[envIdx];
+            stats.episodeReturn = env.getTotalReward(agentIdx);
+            stats.trueObjective = trueObjectives[envIdx][agentIdx];
+            stats.length = env.getNumFrames();
+        }
+
+        // the expensive part of the auto-reset (scenario generation, scene and physics world) runs here in the
+        // worker thread, only the renderer registration of the new episode is left for the main thread
+        env.reset();
+    } else {
+        renderer.preDraw(env, envIdx);
+    }
 }
 
 void VectorEnv::resetEnv(int envIdx)
@@ -58,69 +116,211 @@ void VectorEnv::resetEnv(int envIdx)
 
 void VectorEnv::taskFunc(Task task, int threadIdx)
 {
-    auto func = &VectorEnv::stepEnv;
-    if (task == Task::RESET)
-        func = &VectorEnv::resetEnv;
+    const auto busyStart = std::chrono::steady_clock::now();
+    int numProcessed = 0;
+
+    if (task == Task::STEP || task == Task::RESET) {
+        const auto func = task == Task::RESET ? &VectorEnv::resetEnv : &VectorEnv::stepEnv;
+        const int numEnvs = int(envs.size());
 
-    const auto startIdx = threadIdx * envsPerThread;
-    const auto endIdx = std::min(startIdx + envsPerThread, int(envs.size()));
-    for (int envIdx = startIdx; envIdx < endIdx; ++envIdx)
-        (this->*func)(envIdx);
+        // instead of a fixed slice of envs per thread, every thread keeps grabbing the next chunk until all envs
+        // are processed, so threads that got cheap envs help with the rest of the batch
+        while (true) {
+            const auto startIdx = nextEnvIdx.fetch_add(chunkSize, std::memory_order_relaxed);
+            if (startIdx >= numEnvs)
+                break;
+
+            const auto endIdx = std::min(startIdx + chunkSize, numEnvs);
+            for (int envIdx = startIdx; envIdx < endIdx; ++envIdx)
+                (this->*func)(envIdx);
+
+            numProcessed += endIdx - startIdx;
+        }
+    }
+
+    lastBusyTime[threadIdx] = std::chrono::steady_clock::now() - busyStart;
+    lastNumEnvsProcessed[threadIdx] = numProcessed;
 }
 
-void VectorEnv::executeTask(Task task)
+void VectorEnv::startTask(Task task)
 {
-    numReady = 0;
+    taskStart = std::chrono::steady_clock::now();
 
-    std::unique_lock<std::mutex> lock{mutex};
-    for (int threadIdx = 1; threadIdx < numThreads; ++threadIdx)
-        currTasks[threadIdx] = task;
+    nextEnvIdx = 0;
+    ++dispatchEpoch;
 
-    cvTask.notify_all();
-    lock.unlock();
+    // there is at most one task in flight, so the rings never fill up
+    for (auto &worker : workers) {
+        worker->commands.push(task);
+        worker->commandReady.notifyAll();
+    }
+}
 
+void VectorEnv::finishTask(Task task)
+{
+    // main thread picks up whatever envs are left
     taskFunc(task, 0);
 
-    // just waiting on an atomic, this is a bit faster than conditional variable
-    // tradeoff - using more CPU cycles?
-    while (numReady < numThreads - 1);
+    // depending on the wait policy we either spin, sleep, or spin for a bit and then sleep
+    workersDone.wait([this] {
+        for (const auto &worker : workers)
+            if (worker->completedEpoch.load(std::memory_order_acquire) < dispatchEpoch)
+                return false;
+
+        return true;
+    });
+
+    const auto taskDuration = std::chrono::steady_clock::now() - taskStart;
+
+    for (int threadIdx = 0; threadIdx < numThreads; ++threadIdx) {
+        using Seconds = std::chrono::duration<double>;
+        const auto busy = std::chrono::duration_cast<Seconds>(lastBusyTime[threadIdx]).count();
+        const auto total = std::chrono::duration_cast<Seconds>(taskDuration).count();
+
+        auto &stats = threadStats[threadIdx];
+        stats.busySec += busy;
+        stats.idleSec += std::max(0.0, total - busy);
+        stats.numEnvsProcessed += lastNumEnvsProcessed[threadIdx];
+    }
 }
 
-void VectorEnv::step()
+void VectorEnv::executeTask(Task task)
 {
-    executeTask(Task::STEP);
+    startTask(task);
+    finishTask(task);
+}
 
-    // do this in background thread??
+void VectorEnv::processFinishedEpisodes()
+{
+    resetEnvIndices.clear();
     for (int envIdx = 0; envIdx < int(envs.size()); ++envIdx) {
-        if (envs[envIdx]->isDone()) {
-            done[envIdx] = true;
-            for (int agentIdx = 0; agentIdx < envs[envIdx]->getNumAgents(); ++agentIdx)
-                trueObjectives[envIdx][agentIdx] = envs[envIdx]->trueObjective(agentIdx);
-            envs[envIdx]->reset();
-            renderer.reset(*envs[envIdx], envIdx);
+        done[envIdx] = episodeFinished[envIdx];
+        if (done[envIdx])
+            resetEnvIndices.emplace_back(envIdx);
+    }
+
+    // envs were already reset by the worker threads, we only need to register new episodes with the renderer
+    if (!resetEnvIndices.empty()) {
+        renderer.resetMany(envs, resetEnvIndices);
+        for (auto envIdx : resetEnvIndices)
             renderer.preDraw(*envs[envIdx], envIdx);
-        } else {
-            done[envIdx] = false;
-        }
+    }
+}
+
+void VectorEnv::step()
+{
+    waitStep();
+
+    executeTask(Task::STEP);
+    actionsBatchPending = false;
+    processFinishedEpisodes();
+
+    renderer.swapSnapshots();
+    renderer.draw(envs);
+}
+
+void VectorEnv::stepAsync()
+{
+    if (!snapshotsRequested) {
+        snapshotsRequested = true;
+        snapshotsEnabled = renderer.enableSnapshots();
+
+        // capture the current state, this is what the first waitStep() will render
+        if (snapshotsEnabled)
+            for (int envIdx = 0; envIdx < int(envs.size()); ++envIdx)
+                renderer.preDraw(*envs[envIdx], envIdx);
     }
 
+    if (!snapshotsEnabled) {
+        step();
+        return;
+    }
+
+    waitStep();
+
+    // the state captured at the end of the previous step becomes the front buffer, workers fill the back buffer
+    renderer.swapSnapshots();
+
+    startTask(Task::STEP);
+    stepInFlight = true;
+}
+
+void VectorEnv::waitStep()
+{
+    if (!stepInFlight)
+        return;
+
+    // render the previous step while the worker threads simulate the current one
     renderer.draw(envs);
+
+    finishTask(Task::STEP);
+    actionsBatchPending = false;
+    processFinishedEpisodes();
+
+    stepInFlight = false;
 }
 
 void VectorEnv::reset()
 {
+    waitStep();
+
+    executeTask(Task::RESET);
+
     // reset renderer on the main thread
-    for (int envIdx = 0; envIdx < int(envs.size()); ++envIdx) {
-        envs[envIdx]->reset();
-        renderer.reset(*envs[envIdx], envIdx);
+    resetEnvIndices.resize(envs.size());
+    std::iota(resetEnvIndices.begin(), resetEnvIndices.end(), 0);
+    renderer.resetMany(envs, resetEnvIndices);
+
+    for (int envIdx = 0; envIdx < int(envs.size()); ++envIdx)
         renderer.preDraw(*envs[envIdx], envIdx);
-    }
 
+    renderer.swapSnapshots();
     renderer.draw(envs);
 }
 
+void VectorEnv::setActionsBatch(const int *actions)
+{
+    // workers could still be reading the previous batch
+    waitStep();
+
+    std::copy(actions, actions + actionsBatch.size(), actionsBatch.begin());
+    actionsBatchPending = true;
+}
+
+const std::vector<VectorEnv::EpisodeStats> & VectorEnv::collectEpisodeStats()
+{
+    // the worker threads write the rings while a step is in flight
+    waitStep();
+
+    collectedEpisodeStats.clear();
+
+    for (auto &ring : episodeStatsRings) {
+        const auto capacity = (long long) ring.entries.size();
+        for (auto i = std::max(ring.numRead, ring.numWritten - capacity); i < ring.numWritten; ++i)
+            collectedEpisodeStats.emplace_back(ring.entries[i % capacity]);
+
+        ring.numRead = ring.numWritten;
+    }
+
+    return collectedEpisodeStats;
+}
+
+const std::vector<VectorEnv::ThreadStats> & VectorEnv::getThreadStats()
+{
+    waitStep();
+    return threadStats;
+}
+
+void VectorEnv::resetThreadStats()
+{
+    waitStep();
+    std::fill(threadStats.begin(), threadStats.end(), ThreadStats{});
+}
+
 void VectorEnv::close()
 {
+    waitStep();
+
     executeTask(Task::TERMINATE);
     for (auto &t : backgroundThreads)
         t.join();
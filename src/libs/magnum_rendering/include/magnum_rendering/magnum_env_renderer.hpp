@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <memory>
 
 #include <Magnum/GL/Renderbuffer.h>
@@ -17,6 +18,30 @@
 namespace Megaverse
 {
 
+/**
+ * How MagnumEnvRenderer::draw() gets the observations from the GPU.
+ */
+enum class ReadbackMode
+{
+    // glReadPixels() straight into the observations, every read stalls until the GPU is done
+    Blocking,
+
+    // reads go into pixel buffer objects, the GPU keeps drawing while the transfers are in flight, and the
+    // observations are copied out at the end of draw()
+    Pbo,
+
+    // draw() does not wait for the transfers of this frame and copies out the ones of the previous draw() instead,
+    // so the GPU works while the envs simulate the next step. Observations are one frame behind
+    PboDelayed,
+};
+
+/**
+ * @param name one of "blocking", "pbo", "pbo_delayed" (case-insensitive)
+ * @param ok set to false if the name is not recognized, in which case blocking readback is returned
+ */
+ReadbackMode readbackModeFromString(const std::string &name, bool &ok);
+
+
 class MagnumEnvRenderer : public EnvRenderer
 {
 public:
@@ -28,10 +53,28 @@ public:
 
     void reset(Env &env, int envIdx) override;
 
+    void resetMany(Envs &envs, const std::vector<int> &envIndices) override;
+
     void preDraw(Env &env, int envIdx) override;
 
     void draw(Envs &envs) override;
 
+    bool enableSnapshots() override;
+
+    void swapSnapshots() override;
+
+    /**
+     * Render all agents of all envs into one tall framebuffer, one tile per agent, and read the observations back
+     * with a single glReadPixels() instead of one per agent. Only affects draw().
+     * @return false if the frames don't fit into a framebuffer, in which case nothing changes.
+     */
+    bool enableAtlas();
+
+    /**
+     * Blocking by default. Observations still in flight are copied out before the mode changes.
+     */
+    void setReadbackMode(ReadbackMode mode);
+
     void drawAgent(Env &env, int envIdx, int agentIndex, bool readToBuffer);
 
     const uint8_t * getObservation(int envIdx, int agentIdx) const override;
@@ -1,12 +1,21 @@
+#include <cstring>
+#include <algorithm>
+#include <functional>
+
 #include <Corrade/Containers/GrowableArray.h>
 
 #include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/BufferImage.h>
+#include <Magnum/GL/PixelFormat.h>
+#include <Magnum/GL/OpenGL.h>
 #include <Magnum/GL/DefaultFramebuffer.h>
 #include <Magnum/GL/Mesh.h>
 #include <Magnum/GL/Renderer.h>
 #include <Magnum/ImageView.h>
 #include <Magnum/Math/Color.h>
 #include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Frustum.h>
+#include <Magnum/Math/FunctionsBatch.h>
 #include <Magnum/Trade/MeshData.h>
 #include <Magnum/Shaders/Phong.h>
 #include <Magnum/SceneGraph/Camera.h>
@@ -21,7 +30,9 @@
 #include <Magnum/BulletIntegration/DebugDraw.h>
 
 #include <util/tiny_logger.hpp>
+#include <util/string_utils.hpp>
 
+#include <rendering/static_bvh.hpp>
 #include <rendering/render_utils.hpp>
 
 #include <magnum_rendering/rendering_context.hpp>
@@ -34,34 +45,122 @@ using namespace Magnum::Math::Literals;
 using namespace Megaverse;
 
 
+/**
+ * Per-instance attributes, in world space. The camera matrix of the agent is a shader uniform.
+ */
 struct InstanceData {
     Magnum::Matrix4 transformationMatrix;
     Magnum::Matrix3x3 normalMatrix;
     Magnum::Color3 color;
 };
 
+using InstanceDataMap = std::map<DrawableType, Containers::Array<InstanceData>>;
 
-class CustomDrawable : public SceneGraph::Drawable3D
+/**
+ * World-space instance data of one env, shared by the cameras of all its agents.
+ */
+struct EnvInstances
 {
-public:
-    explicit CustomDrawable(
-        SceneGraph::AbstractObject3D &parentObject,
-        Containers::Array<InstanceData> &instanceData,
-        const Color3 &color,
-        SceneGraph::DrawableGroup3D &drawables
-    )
-    : SceneGraph::Drawable3D{parentObject, &drawables}, _instanceData(instanceData), _color{color}
-    {}
+    // dynamic drawables, captured on every frame
+    InstanceDataMap dynamicInstances;
 
-private:
-    void draw(const Matrix4& t, SceneGraph::Camera3D&) override {
-        arrayAppend(_instanceData, Containers::InPlaceInit, t, t.normalMatrix(), _color);
-    }
+    // static drawables, captured when the episode changes, in the order of the StaticDrawablesMap they come from
+    InstanceDataMap staticInstances;
 
-    Containers::Array<InstanceData>& _instanceData;
-    Color3 _color;
+    // scratch list for the scene graph traversal, reused between frames
+    std::vector<std::reference_wrapper<SceneGraph::AbstractObject3D>> objects;
 };
 
+/**
+ * Everything needed to draw one env, captured in preDraw() when snapshots are enabled.
+ */
+struct DrawSnapshot
+{
+    EnvInstances instances;
+    std::vector<Magnum::Matrix4> cameraMatrices, projectionMatrices;
+
+    // copied only when the episode changes, the hierarchy references staticDrawables
+    StaticDrawablesMap staticDrawables;
+    StaticBvh staticBvh;
+    uint64_t episodeId = 0;
+};
+
+
+/**
+ * World transformations of all dynamic drawables of the env in one pass over the scene graph, so the transformations
+ * of shared parents are computed only once, and nothing is recomputed for every camera.
+ */
+void captureDynamicInstances(Env &env, EnvInstances &instances)
+{
+    const auto &drawables = env.getDrawables();
+
+    for (auto &it : instances.dynamicInstances)
+        arrayResize(it.second, 0);
+
+    instances.objects.clear();
+    for (const auto &[drawableType, sceneObjects] : drawables)
+        for (const auto &sceneObjectInfo : sceneObjects)
+            instances.objects.emplace_back(*sceneObjectInfo.objectPtr);
+
+    if (instances.objects.empty())
+        return;
+
+    SceneGraph::AbstractObject3D &scene = env.getScene();
+    const auto transformations = scene.transformationMatrices(instances.objects);
+
+    size_t i = 0;
+    for (const auto &[drawableType, sceneObjects] : drawables) {
+        auto &data = instances.dynamicInstances[drawableType];
+        for (const auto &sceneObjectInfo : sceneObjects) {
+            const auto &t = transformations[i++];
+            arrayAppend(data, Containers::InPlaceInit, t, t.normalMatrix(), sceneObjectInfo.color);
+        }
+    }
+}
+
+void captureStaticInstances(const StaticDrawablesMap &staticDrawables, EnvInstances &instances)
+{
+    instances.staticInstances.clear();
+
+    for (const auto &[drawableType, drawables] : staticDrawables) {
+        auto &data = instances.staticInstances[drawableType];
+        arrayReserve(data, drawables.size());
+
+        for (const auto &drawable : drawables) {
+            const auto &t = drawable.transformationMatrix;
+            arrayAppend(data, Containers::InPlaceInit, t, t.normalMatrix(), drawable.color);
+        }
+    }
+}
+
+/**
+ * Fill the instance buffer data for one camera: all dynamic drawables, and the static drawables inside of the view
+ * frustum of the camera.
+ * @param staticDrawables what the hierarchy and the static instances were built from
+ */
+void collectInstances(
+    InstanceDataMap &data, const EnvInstances &instances,
+    const StaticDrawablesMap &staticDrawables, const StaticBvh &staticBvh,
+    const Matrix4 &cameraMatrix, const Matrix4 &projectionMatrix
+)
+{
+    for (auto &[drawableType, typeData] : data) {
+        arrayResize(typeData, 0);
+
+        const auto it = instances.dynamicInstances.find(drawableType);
+        if (it != instances.dynamicInstances.end())
+            arrayAppend(typeData, Containers::arrayView(it->second));
+    }
+
+    const auto frustum = Frustum::fromMatrix(projectionMatrix * cameraMatrix);
+
+    staticBvh.forEachVisible(frustum, [&](DrawableType drawableType, const StaticDrawable &drawable) {
+        // static instances are in the same order as the drawables
+        const auto idx = size_t(&drawable - staticDrawables.at(drawableType).data());
+        arrayAppend(data[drawableType], instances.staticInstances.at(drawableType)[idx]);
+    });
+}
+
 
 #ifdef UNUSED
 class SimpleDrawable3D : public Object3D, public SceneGraph::Drawable3D
@@ -96,6 +195,20 @@ private:
 #endif
 
 
+/**
+ * Readback of one draw() through pixel buffer objects. The reads only queue the transfers, the fence tells when
+ * the GPU is done with them.
+ */
+struct PboReadback
+{
+    // one pixel buffer per read (atlas page or agent frame) and the offset of its pixels in the observations
+    std::vector<std::pair<GL::BufferImage2D, size_t>> reads;
+    int numReads = 0;
+
+    GLsync fence = nullptr;
+};
+
+
 struct MagnumEnvRenderer::Impl
 {
 public:
@@ -111,10 +224,70 @@ public:
      */
     void reset(Env &env, int envIndex);
 
+    void resetMany(Envs &envs, const std::vector<int> &envIndices);
+
+    /**
+     * Same as reset(), assuming the rendering context is already current.
+     */
+    void resetEnv(Env &env, int envIndex);
+
     void preDraw(Env &env, int envIndex);
     void draw(Envs &envs);
     void drawAgent(Env &env, int envIndex, int agentIdx, bool readToBuffer);
 
+    /**
+     * Clear the framebuffer, draw the agent's view and read it into the observations.
+     * Assumes updateInstances() was called for the env this frame.
+     */
+    void drawAgentFrame(Env &env, int envIndex, int agentIdx);
+
+    /**
+     * Same as drawAgentFrame(), but draws from the front snapshot buffer and does not touch the env.
+     */
+    void drawAgentSnapshot(int envIndex, int agentIdx);
+
+    /**
+     * Draw the agent's view into the current viewport of the bound framebuffer, without clearing or reading it.
+     * Assumes updateInstances() was called for the env this frame.
+     */
+    void renderAgent(Env &env, int envIndex, int agentIdx);
+
+    void renderAgentSnapshot(int envIndex, int agentIdx);
+
+    /**
+     * Draw all agents into the tiles of the atlas, see MagnumEnvRenderer::enableAtlas().
+     */
+    void drawAtlas(Envs &envs);
+
+    /**
+     * Capture the world-space instances of the dynamic drawables of the env, once per frame for all of its cameras.
+     */
+    void updateInstances(Env &env, int envIndex);
+
+    /**
+     * Upload the contents of instanceData to the GPU and draw all meshes as seen from the camera.
+     */
+    void drawInstances(const Matrix4 &cameraMatrix, const Matrix4 &projectionMatrix);
+
+    /**
+     * Read a part of the framebuffer into the observations at the offset, or queue the read, see ReadbackMode.
+     */
+    void readFrames(GL::Framebuffer &fb, const Range2Di &range, size_t offset);
+
+    /**
+     * Called at the end of draw(), copies the pixel buffers that are due into the observations.
+     */
+    void finishReadback();
+
+    void copyPboReadback(PboReadback &readback);
+
+    void setReadbackMode(ReadbackMode mode);
+
+    bool enableSnapshots();
+    void swapSnapshots() { frontSnapshot = 1 - frontSnapshot; }
+
+    bool enableAtlas();
+
     uint8_t * getObservation(int envIdx, int agentIdx);
 
     GL::Framebuffer * getFramebuffer() { return &framebuffer; }
@@ -129,10 +302,14 @@ public:
 
     Vector2i framebufferSize;
 
-    std::vector<SceneGraph::DrawableGroup3D> envDrawables;
+    std::vector<EnvInstances> envInstances;
+
+    bool snapshotsEnabled = false;
+    int frontSnapshot = 0;
+    std::vector<DrawSnapshot> snapshots[2];
 
     std::map<DrawableType, GL::Buffer> instanceBuffers;
-    std::map<DrawableType, Containers::Array<InstanceData>> instanceData;
+    InstanceDataMap instanceData;
 
     Shaders::Phong shader{NoCreate};
     Shaders::Phong shaderInstanced{NoCreate};
@@ -143,9 +320,29 @@ public:
     std::map<DrawableType, Trade::MeshData> meshData;
     std::map<DrawableType, GL::Mesh> meshes;
 
-    std::vector<std::vector<Containers::Array<uint8_t>>> agentFrames;
+    // bounding boxes of the meshes and the static drawables of every env, for frustum culling
+    std::map<DrawableType, Range3D> meshBounds;
+    std::vector<StaticBvh> staticBvhs;
+
+    // observations of all agents of all envs, one after another, env by env
+    size_t frameSize;
+    Containers::Array<uint8_t> frames;
+    std::vector<int> firstAgent;
     std::vector<std::vector<std::unique_ptr<MutableImageView2D>>> agentImageViews;
 
+    // one tile per agent, stacked vertically, so a readback of the atlas is a readback of all frames in order
+    bool atlasEnabled = false;
+    int tilesPerAtlas = 0;
+    std::vector<std::pair<int, int>> atlasTiles;
+    GL::Framebuffer atlasFramebuffer{NoCreate};
+    GL::Renderbuffer atlasColorBuffer{NoCreate}, atlasDepthBuffer{NoCreate};
+
+    // with delayed readback one buffer is in flight while the other one is being filled
+    ReadbackMode readbackMode = ReadbackMode::Blocking;
+    PboReadback pboReadbacks[2];
+    int currentPboReadback = 0;
+    bool haveObservations = false;
+
     bool withDebugDraw = false;
     BulletIntegration::DebugDraw debugDraw{NoCreate};
 
@@ -182,18 +379,24 @@ MagnumEnvRenderer::Impl::Impl(Envs &envs, int w, int h, bool withDebugDraw, bool
 
     TLOG(INFO) << "Creating Magnum env renderer " << w << " " << h << " " << envs.size();
 
-    for (const auto &e : envs) {
-        std::vector<Containers::Array<uint8_t>> envAgentFrames;
+    frameSize = size_t(framebufferSize.x() * framebufferSize.y() * 4);
+
+    int numAgentsTotal = 0;
+    for (const auto &e : envs)
+        firstAgent.push_back(numAgentsTotal), numAgentsTotal += e->getNumAgents();
+
+    frames = Containers::Array<uint8_t>(frameSize * size_t(numAgentsTotal));
+
+    for (int envIdx = 0; envIdx < int(envs.size()); ++envIdx) {
         std::vector<std::unique_ptr<MutableImageView2D>> envAgentImageViews;
 
-        for (int i = 0; i < e->getNumAgents(); ++i) {
-            envAgentFrames.emplace_back(size_t(framebufferSize.x() * framebufferSize.y() * 4));
+        for (int i = 0; i < envs[envIdx]->getNumAgents(); ++i) {
+            const auto offset = frameSize * size_t(firstAgent[envIdx] + i);
             envAgentImageViews.emplace_back(
-                std::make_unique<MutableImageView2D>(PixelFormat::RGBA8Unorm, framebufferSize, envAgentFrames[i])
+                std::make_unique<MutableImageView2D>(PixelFormat::RGBA8Unorm, framebufferSize, frames.slice(offset, offset + frameSize))
             );
         }
 
-        agentFrames.emplace_back(std::move(envAgentFrames));
         agentImageViews.emplace_back(std::move(envAgentImageViews));
     }
 
@@ -207,10 +410,15 @@ MagnumEnvRenderer::Impl::Impl(Envs &envs, int w, int h, bool withDebugDraw, bool
     // meshes
     {
         initPrimitives(meshData);
-        for (const auto &[drawable, data] : meshData)
+        for (const auto &[drawable, data] : meshData) {
             meshes[drawable] = MeshTools::compile(data);
 
+            const auto [min, max] = Math::minmax(data.positions3DAsArray());
+            meshBounds[drawable] = Range3D{min, max};
+        }
+
         for (auto &[k, v] : meshes) {
+            instanceData[k] = {};
             instanceBuffers[k] = GL::Buffer{};
             v.addVertexBufferInstanced(
                 instanceBuffers[k], 1, 0,
@@ -223,7 +431,8 @@ MagnumEnvRenderer::Impl::Impl(Envs &envs, int w, int h, bool withDebugDraw, bool
 
     // drawables
     {
-        envDrawables = std::vector<SceneGraph::DrawableGroup3D>(envs.size());
+        envInstances = std::vector<EnvInstances>(envs.size());
+        staticBvhs = std::vector<StaticBvh>(envs.size());
     }
 
     if (withDebugDraw) {
@@ -237,6 +446,10 @@ MagnumEnvRenderer::Impl::~Impl()
     TLOG(INFO) << __PRETTY_FUNCTION__;
     if (windowlessContextPtr)
         windowlessContextPtr->makeCurrent();
+
+    for (auto &readback : pboReadbacks)
+        if (readback.fence)
+            glDeleteSync(readback.fence);
 }
 
 RenderingContext * MagnumEnvRenderer::Impl::initContext(RenderingContext *context)
@@ -256,62 +469,172 @@ RenderingContext * MagnumEnvRenderer::Impl::initContext(RenderingContext *contex
 void MagnumEnvRenderer::Impl::reset(Env &env, int envIndex)
 {
     ctx->makeCurrent();
+    resetEnv(env, envIndex);
+}
 
-    // reset renderer data structures
-    {
-        envDrawables[envIndex] = SceneGraph::DrawableGroup3D{};
+void MagnumEnvRenderer::Impl::resetMany(Envs &envs, const std::vector<int> &envIndices)
+{
+    // switch the context once for the whole batch of finished episodes
+    ctx->makeCurrent();
 
-        for (const auto &it : meshes)
-            arrayResize(instanceData[it.first], 0);
-    }
+    for (auto envIdx : envIndices)
+        resetEnv(*envs[envIdx], envIdx);
+}
 
-    // drawables
+void MagnumEnvRenderer::Impl::resetEnv(Env &env, int envIndex)
+{
+    // the static drawables don't move, only the dynamic ones are captured on every frame
     {
-        const auto &drawables = env.getDrawables();
-
-        for (auto &it : meshes) {
-            for (const auto &sceneObjectInfo : drawables.at(it.first)) {
-                const auto &color = sceneObjectInfo.color;
-                sceneObjectInfo.objectPtr->addFeature<CustomDrawable>(instanceData[it.first], color, envDrawables[envIndex]);
-            }
-        }
+        captureStaticInstances(env.getStaticDrawables(), envInstances[envIndex]);
+        staticBvhs[envIndex].build(env.getStaticDrawables(), meshBounds);
     }
 
     if (withOverviewCamera && envIndex == 0)
         overview.reset(&env.getScene());
 }
 
-void MagnumEnvRenderer::Impl::preDraw(Env &, int)
+void MagnumEnvRenderer::Impl::preDraw(Env &env, int envIndex)
+{
+    if (!snapshotsEnabled)
+        return;
+
+    // called from the worker threads, each writing only to the back buffer of its own env
+    auto &snapshot = snapshots[1 - frontSnapshot][envIndex];
+
+    captureDynamicInstances(env, snapshot.instances);
+
+    if (snapshot.episodeId != env.getEpisodeId()) {
+        snapshot.staticDrawables = env.getStaticDrawables();
+        captureStaticInstances(snapshot.staticDrawables, snapshot.instances);
+        snapshot.staticBvh.build(snapshot.staticDrawables, meshBounds);
+        snapshot.episodeId = env.getEpisodeId();
+    }
+
+    const auto numAgents = env.getNumAgents();
+    snapshot.cameraMatrices.resize(size_t(numAgents));
+    snapshot.projectionMatrices.resize(size_t(numAgents));
+
+    for (int agentIdx = 0; agentIdx < numAgents; ++agentIdx) {
+        auto camera = env.getAgents()[agentIdx]->getCamera();
+        snapshot.cameraMatrices[agentIdx] = camera->cameraMatrix();
+        snapshot.projectionMatrices[agentIdx] = camera->projectionMatrix();
+    }
+}
+
+bool MagnumEnvRenderer::Impl::enableSnapshots()
+{
+    for (auto &s : snapshots)
+        s = std::vector<DrawSnapshot>(firstAgent.size());
+
+    snapshotsEnabled = true;
+    return true;
+}
+
+void MagnumEnvRenderer::Impl::updateInstances(Env &env, int envIndex)
+{
+    captureDynamicInstances(env, envInstances[envIndex]);
+}
+
+void MagnumEnvRenderer::Impl::drawInstances(const Matrix4 &cameraMatrix, const Matrix4 &projectionMatrix)
+{
+    // the instances are in world space, the camera transformation is applied in the shader
+    shaderInstanced
+        .setTransformationMatrix(cameraMatrix)
+        .setNormalMatrix(cameraMatrix.normalMatrix())
+        .setProjectionMatrix(projectionMatrix);
+
+    // Upload instance data to the GPU (orphaning the previous buffer contents) and draw all meshes in one call
+    for (auto &[drawableType, mesh] : meshes)
+        if (!instanceData[drawableType].empty()) {
+            instanceBuffers[drawableType].setData(instanceData[drawableType], GL::BufferUsage::DynamicDraw);
+            mesh.setInstanceCount(Int(instanceData[drawableType].size()));
+            shaderInstanced.draw(mesh);
+        }
+}
+
+bool MagnumEnvRenderer::Impl::enableAtlas()
 {
+    if (atlasEnabled)
+        return true;
+
+    ctx->makeCurrent();
+
+    const auto maxSize = GL::Renderbuffer::maxSize();
+    const int numAgentsTotal = int(frames.size() / frameSize);
+
+    tilesPerAtlas = std::min(numAgentsTotal, maxSize / framebufferSize.y());
+    if (tilesPerAtlas < 1 || framebufferSize.x() > maxSize) {
+        TLOG(ERROR) << "Frames of size " << framebufferSize.x() << "x" << framebufferSize.y() << " do not fit into an atlas, max size " << maxSize;
+        return false;
+    }
+
+    if (tilesPerAtlas < numAgentsTotal)
+        TLOG(WARNING) << "Atlas only fits " << tilesPerAtlas << " of " << numAgentsTotal << " agents, frames will be read back in several parts";
+
+    const Vector2i atlasSize{framebufferSize.x(), framebufferSize.y() * tilesPerAtlas};
+
+    atlasColorBuffer = GL::Renderbuffer{};
+    atlasColorBuffer.setStorage(GL::RenderbufferFormat::SRGB8Alpha8, atlasSize);
+    atlasDepthBuffer = GL::Renderbuffer{};
+    atlasDepthBuffer.setStorage(GL::RenderbufferFormat::DepthComponent24, atlasSize);
+
+    atlasFramebuffer = GL::Framebuffer{Range2Di{{}, atlasSize}};
+    atlasFramebuffer.attachRenderbuffer(GL::Framebuffer::ColorAttachment{0}, atlasColorBuffer);
+    atlasFramebuffer.attachRenderbuffer(GL::Framebuffer::BufferAttachment::Depth, atlasDepthBuffer);
+    atlasFramebuffer.mapForDraw({{Shaders::Phong::ColorOutput, GL::Framebuffer::ColorAttachment{0}}});
+
+    CORRADE_INTERNAL_ASSERT(atlasFramebuffer.checkStatus(GL::FramebufferTarget::Draw) == GL::Framebuffer::Status::Complete);
+
+    atlasTiles.clear();
+    for (int envIdx = 0; envIdx < int(firstAgent.size()); ++envIdx) {
+        const int numAgents = (envIdx + 1 < int(firstAgent.size()) ? firstAgent[envIdx + 1] : numAgentsTotal) - firstAgent[envIdx];
+        for (int agentIdx = 0; agentIdx < numAgents; ++agentIdx)
+            atlasTiles.emplace_back(envIdx, agentIdx);
+    }
+
+    atlasEnabled = true;
+    return true;
 }
 
 void MagnumEnvRenderer::Impl::drawAgent(Env &env, int envIndex, int agentIdx, bool readToBuffer)
 {
+    updateInstances(env, envIndex);
+
     framebuffer
         .clearColor(0, Color3{0})
         .clearDepth(1.0f)
         .bind();
 
-    for (auto &it : meshes)
-        arrayResize(instanceData[it.first], 0);
+    renderAgent(env, envIndex, agentIdx);
+
+    if (readToBuffer) {
+        framebuffer.mapForRead(GL::Framebuffer::ColorAttachment{0});
+        framebuffer.read(framebuffer.viewport(), *agentImageViews[envIndex][agentIdx]);
+    }
+}
+
+void MagnumEnvRenderer::Impl::drawAgentFrame(Env &env, int envIndex, int agentIdx)
+{
+    framebuffer
+        .clearColor(0, Color3{0})
+        .clearDepth(1.0f)
+        .bind();
+
+    renderAgent(env, envIndex, agentIdx);
+
+    readFrames(framebuffer, framebuffer.viewport(), frameSize * size_t(firstAgent[envIndex] + agentIdx));
+}
 
+void MagnumEnvRenderer::Impl::renderAgent(Env &env, int envIndex, int agentIdx)
+{
     auto activeCameraPtr = env.getAgents()[agentIdx]->getCamera();
     if (withOverviewCamera && overview.enabled && envIndex == 0)
         activeCameraPtr = overview.camera;
 
-    // Would be nice to implement frustrum culling here: https://doc.magnum.graphics/magnum/classMagnum_1_1SceneGraph_1_1Drawable.html#SceneGraph-Drawable-draw-order
-    // Although Vulkan renderer is so much faster, who cares
-    activeCameraPtr->draw(envDrawables[envIndex]);
+    const auto cameraMatrix = activeCameraPtr->cameraMatrix(), projectionMatrix = activeCameraPtr->projectionMatrix();
+    collectInstances(instanceData, envInstances[envIndex], env.getStaticDrawables(), staticBvhs[envIndex], cameraMatrix, projectionMatrix);
 
-    shaderInstanced.setProjectionMatrix(activeCameraPtr->projectionMatrix());
-
-    // Upload instance data to the GPU (orphaning the previous buffer contents) and draw all meshes in one call
-    for (auto &[drawableType, mesh] : meshes)
-        if (!instanceData[drawableType].empty()) {
-            instanceBuffers[drawableType].setData(instanceData[drawableType], GL::BufferUsage::DynamicDraw);
-            mesh.setInstanceCount(Int(instanceData[drawableType].size()));
-            shaderInstanced.draw(mesh);
-        }
+    drawInstances(cameraMatrix, projectionMatrix);
 
     // Bullet debug draw
     if (withDebugDraw) {
@@ -323,25 +646,171 @@ void MagnumEnvRenderer::Impl::drawAgent(Env &env, int envIndex, int agentIdx, bo
         env.getPhysics().bWorld.debugDrawWorld();
         GL::Renderer::setDepthFunction(GL::Renderer::DepthFunction::Less);
     }
+}
 
-    if (readToBuffer) {
-        framebuffer.mapForRead(GL::Framebuffer::ColorAttachment{0});
-        framebuffer.read(framebuffer.viewport(), *agentImageViews[envIndex][agentIdx]);
+void MagnumEnvRenderer::Impl::drawAgentSnapshot(int envIndex, int agentIdx)
+{
+    framebuffer
+        .clearColor(0, Color3{0})
+        .clearDepth(1.0f)
+        .bind();
+
+    renderAgentSnapshot(envIndex, agentIdx);
+
+    readFrames(framebuffer, framebuffer.viewport(), frameSize * size_t(firstAgent[envIndex] + agentIdx));
+}
+
+void MagnumEnvRenderer::Impl::renderAgentSnapshot(int envIndex, int agentIdx)
+{
+    const auto &snapshot = snapshots[frontSnapshot][envIndex];
+    const auto &cameraMatrix = snapshot.cameraMatrices[agentIdx], &projectionMatrix = snapshot.projectionMatrices[agentIdx];
+
+    collectInstances(instanceData, snapshot.instances, snapshot.staticDrawables, snapshot.staticBvh, cameraMatrix, projectionMatrix);
+
+    drawInstances(cameraMatrix, projectionMatrix);
+}
+
+void MagnumEnvRenderer::Impl::drawAtlas(Envs &envs)
+{
+    const int w = framebufferSize.x(), h = framebufferSize.y();
+    const int numTiles = int(atlasTiles.size());
+
+    for (int firstTile = 0; firstTile < numTiles; firstTile += tilesPerAtlas) {
+        const int numPageTiles = std::min(tilesPerAtlas, numTiles - firstTile);
+
+        atlasFramebuffer
+            .clearColor(0, Color3{0})
+            .clearDepth(1.0f)
+            .bind();
+
+        for (int tile = 0; tile < numPageTiles; ++tile) {
+            const auto [envIdx, agentIdx] = atlasTiles[firstTile + tile];
+            atlasFramebuffer.setViewport({{0, tile * h}, {w, (tile + 1) * h}});
+
+            if (!snapshotsEnabled)
+                renderAgent(*envs[envIdx], envIdx, agentIdx);
+            else if (agentIdx < int(snapshots[frontSnapshot][envIdx].cameraMatrices.size()))
+                renderAgentSnapshot(envIdx, agentIdx);
+        }
+
+        // rows of the tiles are the frames of the agents one after another, read them all at once
+        readFrames(atlasFramebuffer, {{}, {w, numPageTiles * h}}, frameSize * size_t(firstTile));
+    }
+}
+
+void MagnumEnvRenderer::Impl::readFrames(GL::Framebuffer &fb, const Range2Di &range, size_t offset)
+{
+    fb.mapForRead(GL::Framebuffer::ColorAttachment{0});
+
+    if (readbackMode == ReadbackMode::Blocking) {
+        const auto size = size_t(range.size().product()) * 4;
+        MutableImageView2D image{PixelFormat::RGBA8Unorm, range.size(), frames.slice(offset, offset + size)};
+        fb.read(range, image);
+        return;
+    }
+
+    auto &readback = pboReadbacks[currentPboReadback];
+    if (readback.numReads == int(readback.reads.size()))
+        readback.reads.emplace_back(GL::BufferImage2D{GL::PixelFormat::RGBA, GL::PixelType::UnsignedByte}, 0);
+
+    auto &[image, imageOffset] = readback.reads[readback.numReads++];
+    fb.read(range, image, GL::BufferUsage::StreamRead);
+    imageOffset = offset;
+}
+
+void MagnumEnvRenderer::Impl::finishReadback()
+{
+    if (readbackMode != ReadbackMode::Blocking) {
+        auto &current = pboReadbacks[currentPboReadback], &previous = pboReadbacks[1 - currentPboReadback];
+
+        current.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // make sure the GPU starts working on this frame before we go back to the simulation
+        glFlush();
+
+        if (readbackMode == ReadbackMode::Pbo)
+            copyPboReadback(current);
+        else if (previous.fence)
+            copyPboReadback(previous);
+        else if (!haveObservations)
+            copyPboReadback(current);  // nothing drawn before, don't return empty frames
+
+        currentPboReadback = 1 - currentPboReadback;
     }
+
+    haveObservations = true;
+}
+
+void MagnumEnvRenderer::Impl::copyPboReadback(PboReadback &readback)
+{
+    if (!readback.fence)
+        return;
+
+    GLenum status;
+    do
+        status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000);
+    while (status == GL_TIMEOUT_EXPIRED);
+
+    if (status == GL_WAIT_FAILED)
+        TLOG(ERROR) << "Waiting for the readback fence failed";
+
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+
+    for (int i = 0; i < readback.numReads; ++i) {
+        auto &[image, offset] = readback.reads[i];
+        const auto size = size_t(image.size().product()) * 4;
+
+        const auto data = image.buffer().map(0, GLsizeiptr(size), GL::Buffer::MapFlag::Read);
+        if (data)
+            std::memcpy(frames.data() + offset, static_cast<const char *>(data), size);
+        else
+            TLOG(ERROR) << "Could not map the readback buffer";
+
+        image.buffer().unmap();
+    }
+
+    readback.numReads = 0;
+}
+
+void MagnumEnvRenderer::Impl::setReadbackMode(ReadbackMode mode)
+{
+    ctx->makeCurrent();
+
+    // whatever is in flight belongs to the latest frames, don't lose it
+    for (int i = 1; i <= 2; ++i)
+        copyPboReadback(pboReadbacks[(currentPboReadback + i) % 2]);
+
+    readbackMode = mode;
 }
 
 void MagnumEnvRenderer::Impl::draw(Envs &envs)
 {
     ctx->makeCurrent();
 
-    for (int envIdx = 0; envIdx < int(envs.size()); ++envIdx)
-        for (int agentIdx = 0; agentIdx < envs[envIdx]->getNumAgents(); ++agentIdx)
-            drawAgent(*envs[envIdx], envIdx, agentIdx, true);
+    // world transformations once per env, all agents of the env only differ in the camera matrix
+    if (!snapshotsEnabled)
+        for (int envIdx = 0; envIdx < int(envs.size()); ++envIdx)
+            updateInstances(*envs[envIdx], envIdx);
+
+    if (atlasEnabled) {
+        drawAtlas(envs);
+    } else if (snapshotsEnabled) {
+        // the envs might be simulating the next step right now, only the snapshot is safe to read
+        for (int envIdx = 0; envIdx < int(snapshots[frontSnapshot].size()); ++envIdx)
+            for (int agentIdx = 0; agentIdx < int(snapshots[frontSnapshot][envIdx].cameraMatrices.size()); ++agentIdx)
+                drawAgentSnapshot(envIdx, agentIdx);
+    } else {
+        for (int envIdx = 0; envIdx < int(envs.size()); ++envIdx)
+            for (int agentIdx = 0; agentIdx < envs[envIdx]->getNumAgents(); ++agentIdx)
+                drawAgentFrame(*envs[envIdx], envIdx, agentIdx);
+    }
+
+    finishReadback();
 }
 
 uint8_t * MagnumEnvRenderer::Impl::getObservation(int envIdx, int agentIdx)
 {
-    return agentFrames[envIdx][agentIdx].data();
+    return frames.data() + frameSize * size_t(firstAgent[envIdx] + agentIdx);
 }
 
 MagnumEnvRenderer::MagnumEnvRenderer(Envs &envs, int w, int h, bool withDebugDraw, bool withOverview, RenderingContext *ctx)
@@ -357,6 +826,11 @@ void MagnumEnvRenderer::reset(Env &env, int envIdx)
     pimpl->reset(env, envIdx);
 }
 
+void MagnumEnvRenderer::resetMany(Envs &envs, const std::vector<int> &envIndices)
+{
+    pimpl->resetMany(envs, envIndices);
+}
+
 void MagnumEnvRenderer::preDraw(Env &env, int envIdx)
 {
     pimpl->preDraw(env, envIdx);
@@ -367,6 +841,26 @@ void MagnumEnvRenderer::draw(Envs &envs)
     pimpl->draw(envs);
 }
 
+bool MagnumEnvRenderer::enableSnapshots()
+{
+    return pimpl->enableSnapshots();
+}
+
+void MagnumEnvRenderer::swapSnapshots()
+{
+    pimpl->swapSnapshots();
+}
+
+bool MagnumEnvRenderer::enableAtlas()
+{
+    return pimpl->enableAtlas();
+}
+
+void MagnumEnvRenderer::setReadbackMode(ReadbackMode mode)
+{
+    pimpl->setReadbackMode(mode);
+}
+
 void MagnumEnvRenderer::drawAgent(Env &env, int envIndex, int agentIndex, bool readToBuffer)
 {
     pimpl->drawAgent(env, envIndex, agentIndex, readToBuffer);
@@ -391,3 +885,20 @@ Overview * Megaverse::MagnumEnvRenderer::getOverview()
 {
     return pimpl->getOverview();
 }
+
+
+ReadbackMode Megaverse::readbackModeFromString(const std::string &name, bool &ok)
+{
+    ok = true;
+
+    const auto lowercase = toLower(name);
+    if (lowercase == "blocking")
+        return ReadbackMode::Blocking;
+    else if (lowercase == "pbo")
+        return ReadbackMode::Pbo;
+    else if (lowercase == "pbo_delayed")
+        return ReadbackMode::PboDelayed;
+
+    ok = false;
+    return ReadbackMode::Blocking;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/Math/Frustum.h>
+
+#include <env/env.hpp>
+
+
+namespace Megaverse
+{
+
+/**
+ * Bounding volume hierarchy over the static drawables of an episode (see Env::getStaticDrawables()). The static
+ * drawables don't move, so it is built once per episode, and then every camera only visits the instances that
+ * intersect its view frustum instead of all of them.
+ * The hierarchy references the drawables, it must be rebuilt when they change.
+ */
+class StaticBvh
+{
+public:
+    /**
+     * @param localBounds bounding box of the mesh of every drawable type, in the mesh coordinates
+     */
+    void build(const StaticDrawablesMap &staticDrawables, const std::map<DrawableType, Magnum::Range3D> &localBounds);
+
+    /**
+     * Call f(drawableType, staticDrawable) for every drawable whose bounding box is at least partially inside the
+     * frustum, in no particular order.
+     */
+    template<typename F>
+    void forEachVisible(const Magnum::Frustum &frustum, F &&f) const
+    {
+        if (nodes.empty())
+            return;
+
+        int stack[maxDepth + 1], stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0) {
+            const auto &node = nodes[stack[--stackSize]];
+
+            const auto test = testBox(node.bounds, frustum);
+            if (test == Outside)
+                continue;
+
+            if (test == Inside || node.left < 0) {
+                // everything below a node that is fully inside is visible, no need to go further down
+                for (int i = node.firstItem; i < node.lastItem; ++i)
+                    if (test == Inside || testBox(items[i].bounds, frustum) != Outside)
+                        f(items[i].drawableType, *items[i].drawable);
+
+                continue;
+            }
+
+            stack[stackSize++] = node.left;
+            stack[stackSize++] = node.left + 1;
+        }
+    }
+
+    int size() const { return int(items.size()); }
+
+    Magnum::Range3D bounds() const { return nodes.empty() ? Magnum::Range3D{} : nodes.front().bounds; }
+
+private:
+    enum Containment { Outside, Intersecting, Inside };
+
+    static constexpr int maxItemsPerLeaf = 4, maxDepth = 32;
+
+    static Containment testBox(const Magnum::Range3D &box, const Magnum::Frustum &frustum);
+
+    void buildNode(int nodeIdx, int first, int last, int depth);
+
+private:
+    struct Item
+    {
+        Magnum::Range3D bounds;
+        DrawableType drawableType;
+        const StaticDrawable *drawable;
+    };
+
+    struct Node
+    {
+        Magnum::Range3D bounds;
+
+        // items of the subtree
+        int firstItem, lastItem;
+
+        // children are next to each other, left + 1 is the right one, -1 for leaves
+        int left;
+    };
+
+    std::vector<Item> items;
+    std::vector<Node> nodes;
+};
+
+}
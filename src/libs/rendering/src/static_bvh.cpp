@@ -0,0 +1,114 @@
+#include <cmath>
+#include <algorithm>
+
+#include <Magnum/Math/Matrix4.h>
+
+#include <rendering/static_bvh.hpp>
+
+using namespace Megaverse;
+
+using namespace Magnum;
+
+
+namespace
+{
+
+/**
+ * World-space bounding box of a transformed box.
+ */
+Range3D transformBox(const Matrix4 &m, const Range3D &box)
+{
+    const auto center = m.transformPoint(box.center());
+    const auto halfSize = box.size() / 2;
+
+    Vector3 extent;
+    for (int row = 0; row < 3; ++row)
+        for (int col = 0; col < 3; ++col)
+            extent[row] += std::abs(m[col][row]) * halfSize[col];
+
+    return {center - extent, center + extent};
+}
+
+}
+
+
+void StaticBvh::build(const StaticDrawablesMap &staticDrawables, const std::map<DrawableType, Range3D> &localBounds)
+{
+    items.clear(), nodes.clear();
+
+    for (const auto &[drawableType, drawables] : staticDrawables) {
+        const auto boundsIt = localBounds.find(drawableType);
+        if (boundsIt == localBounds.end())
+            continue;  // no mesh for this type, nothing to draw
+
+        for (const auto &drawable : drawables)
+            items.push_back({transformBox(drawable.transformationMatrix, boundsIt->second), drawableType, &drawable});
+    }
+
+    if (items.empty())
+        return;
+
+    // the children are added in pairs, so the tree can't have more than 2n - 1 nodes
+    nodes.reserve(2 * items.size());
+    nodes.emplace_back();
+    buildNode(0, 0, int(items.size()), 0);
+}
+
+void StaticBvh::buildNode(int nodeIdx, int first, int last, int depth)
+{
+    auto bounds = items[first].bounds;
+    Range3D centers{bounds.center(), bounds.center()};
+
+    for (int i = first + 1; i < last; ++i) {
+        const auto &itemBounds = items[i].bounds;
+        bounds = Math::join(bounds, itemBounds);
+        centers = Math::join(centers, Range3D{itemBounds.center(), itemBounds.center()});
+    }
+
+    nodes[nodeIdx] = {bounds, first, last, -1};
+
+    if (last - first <= maxItemsPerLeaf || depth >= maxDepth)
+        return;
+
+    // median split along the longest axis of the item centers
+    const auto size = centers.size();
+    const int axis = size.x() >= size.y() && size.x() >= size.z() ? 0 : (size.y() >= size.z() ? 1 : 2);
+    if (size[axis] <= 0)
+        return;  // all items in the same place, can't split
+
+    const int mid = (first + last) / 2;
+    std::nth_element(items.begin() + first, items.begin() + mid, items.begin() + last, [axis](const Item &a, const Item &b) {
+        return a.bounds.center()[axis] < b.bounds.center()[axis];
+    });
+
+    const int left = int(nodes.size());
+    nodes[nodeIdx].left = left;
+    nodes.emplace_back(), nodes.emplace_back();
+
+    buildNode(left, first, mid, depth + 1);
+    buildNode(left + 1, mid, last, depth + 1);
+}
+
+StaticBvh::Containment StaticBvh::testBox(const Range3D &box, const Frustum &frustum)
+{
+    auto result = Inside;
+
+    for (size_t i = 0; i < 6; ++i) {
+        const auto &plane = frustum[i];
+        const auto normal = plane.xyz();
+
+        // corners of the box furthest along and against the plane normal
+        Vector3 along, against;
+        for (int k = 0; k < 3; ++k) {
+            along[k] = normal[k] >= 0 ? box.max()[k] : box.min()[k];
+            against[k] = normal[k] >= 0 ? box.min()[k] : box.max()[k];
+        }
+
+        if (Math::dot(normal, along) + plane.w() < 0)
+            return Outside;
+        if (Math::dot(normal, against) + plane.w() < 0)
+            result = Intersecting;
+    }
+
+    return result;
+}
@@ -42,6 +42,10 @@ public:
         std::fill(carryingObject.begin(), carryingObject.end(), nullptr);
     }
 
+    void saveState(SnapshotWriter &writer) const override { writer.write(carryingObject); }
+
+    void loadState(SnapshotReader &reader) override { reader.read(carryingObject); }
+
     void step(Env &env, Env::EnvState &envState) override
     {
         for (int i = 0; i < env.getNumAgents(); ++i) {
@@ -176,9 +180,7 @@ public:
             const auto pos = movableObject;
             auto translation = Magnum::Vector3{float(pos.x()) + 0.5f, float(pos.y()) + 0.5f, float(pos.z()) + 0.5f};
 
-            auto bBoxShape = std::make_unique<btBoxShape>(btVector3{1, 1, 1});
-
-            auto &object = envState.scene->addChild<RigidBody>(envState.scene.get(), 0.0f, bBoxShape.get(), envState.physics->bWorld);
+            auto &object = envState.addChild<RigidBody>(*envState.scene, envState.physics->boxShapes, envState.physics->bWorld);
             object.scale(objScale).translate(translation);
             object.setCollisionScale({1.15f, 1.15f, 1.15f});
             object.setCollisionOffset({0, -0.05f, 0});
@@ -186,8 +188,6 @@ public:
 
             drawables[DrawableType::Box].emplace_back(&object, rgb(ColorRgb::MOVABLE_BOX));
 
-            envState.physics->collisionShapes.emplace_back(std::move(bBoxShape));
-
             if (!grid.hasVoxel(pos)) {
                 VoxelT voxelState;
                 grid.set(pos, voxelState);
@@ -70,6 +70,35 @@ public:
 
     void reset(Env &, Env::EnvState &) override { grid.clear(); }
 
+    void saveState(SnapshotWriter &writer) const override
+    {
+        static_assert(std::is_trivially_copyable_v<VoxelT>, "Voxels are copied into snapshots as raw bytes");
+
+        const auto &voxels = grid.getHashMap();
+        writer.write(uint64_t(voxels.size()));
+
+        for (const auto &[coords, voxel] : voxels) {
+            writer.writeArray(coords.data(), 3);
+            writer.write(voxel);
+        }
+    }
+
+    void loadState(SnapshotReader &reader) override
+    {
+        const auto numVoxels = size_t(reader.read<uint64_t>());
+        const auto voxelsReader = reader;
+
+        // voxels are rarely added or removed mid-episode, normally we just overwrite the existing ones in place
+        readVoxels(reader, numVoxels);
+
+        if (grid.getHashMap().size() != numVoxels) {
+            // there are voxels added after the snapshot, rebuild the grid
+            grid.clear();
+            auto r = voxelsReader;
+            readVoxels(r, numVoxels);
+        }
+    }
+
     void addPlatform(const Platform &p, ColorRgb layoutColor, ColorRgb wallColor, bool drawWalls = true)
     {
         for (auto &bb : p.layoutBoxes)
@@ -186,6 +215,19 @@ public:
         return boxesByVoxelType;
     }
 
+private:
+    void readVoxels(SnapshotReader &reader, size_t numVoxels)
+    {
+        VoxelCoords coords;
+        VoxelT voxel;
+
+        for (size_t i = 0; i < numVoxels; ++i) {
+            reader.readArray(coords.data(), 3);
+            reader.read(voxel);
+            grid.set(coords, voxel);
+        }
+    }
+
 public:
     VoxelGrid<VoxelT> grid;
 };
@@ -13,33 +13,35 @@ namespace Megaverse::Str
              obstaclesMaxLava = "obstaclesMaxLava",
              obstaclesMinHeight = "obstaclesMinHeight",
              obstaclesMaxHeight = "obstaclesMaxHeight",
-             obstaclesAgentAtExit = "obstaclesAgentAtExit",
-             obstaclesAllAgentsAtExit = "obstaclesAllAgentsAtExit",
-             obstaclesExtraReward = "obstaclesExtraReward",
-             obstaclesNumAllowedMaxDifficulty = "obstaclesNumAllowedMaxDifficulty",
-             obstaclesAgentCarriedObjectToExit = "obstaclesAgentCarriedObjectToExit";
+             obstaclesNumAllowedMaxDifficulty = "obstaclesNumAllowedMaxDifficulty";
 
-    ConstStr towerPickedUpObject = "towerPickedUpObject",
-             towerVisitedBuildingZoneWithObject = "towerVisitedBuildingZoneWithObject",
-             towerBuildingReward = "towerBuildingReward";
+    // rewards, ids are unique across all scenarios, 0 is Str::teamSpirit
+    constexpr RewardName obstaclesAgentAtExit{"obstaclesAgentAtExit", 1},
+                         obstaclesAllAgentsAtExit{"obstaclesAllAgentsAtExit", 2},
+                         obstaclesExtraReward{"obstaclesExtraReward", 3},
+                         obstaclesAgentCarriedObjectToExit{"obstaclesAgentCarriedObjectToExit", 4};
 
-    ConstStr collectSingleGood = "collectSingleGood",
-             collectSingleBad = "collectSingleBad",
-             collectAll = "collectAll",
-             collectAbyss = "collectAbyss";
+    constexpr RewardName towerPickedUpObject{"towerPickedUpObject", 5},
+                         towerVisitedBuildingZoneWithObject{"towerVisitedBuildingZoneWithObject", 6},
+                         towerBuildingReward{"towerBuildingReward", 7};
 
-    ConstStr sokobanBoxOnTarget = "sokobanBoxOnTarget",
-             sokobanBoxLeavesTarget = "sokobanBoxLeavesTarget",
-             sokobanAllBoxesOnTarget = "sokobanAllBoxesOnTarget";
+    constexpr RewardName collectSingleGood{"collectSingleGood", 8},
+                         collectSingleBad{"collectSingleBad", 9},
+                         collectAll{"collectAll", 10},
+                         collectAbyss{"collectAbyss", 11};
 
-    ConstStr boxagoneTouchedFloor = "boxagoneTouchedFloor",
-             boxagonePerStepReward = "boxagonePerStepReward";
+    constexpr RewardName sokobanBoxOnTarget{"sokobanBoxOnTarget", 12},
+                         sokobanBoxLeavesTarget{"sokobanBoxLeavesTarget", 13},
+                         sokobanAllBoxesOnTarget{"sokobanAllBoxesOnTarget", 14};
 
-    ConstStr exploreSolved = "exploreSolved";
+    constexpr RewardName boxagoneTouchedFloor{"boxagoneTouchedFloor", 15},
+                         boxagonePerStepReward{"boxagonePerStepReward", 16};
 
-    ConstStr memoryCollectGood = "memoryCollectGood",
-             memoryCollectBad = "memoryCollectBad";
+    constexpr RewardName exploreSolved{"exploreSolved", 17};
 
-    ConstStr rearrangeOneMoreObjectCorrectPosition = "rearrangeOneMoreObjectCorrectPosition",
-             rearrangeAllObjectsCorrectPosition = "rearrangeAllObjectsCorrectPosition";
+    constexpr RewardName memoryCollectGood{"memoryCollectGood", 18},
+                         memoryCollectBad{"memoryCollectBad", 19};
+
+    constexpr RewardName rearrangeOneMoreObjectCorrectPosition{"rearrangeOneMoreObjectCorrectPosition", 20},
+                         rearrangeAllObjectsCorrectPosition{"rearrangeAllObjectsCorrectPosition", 21};
 }
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include <util/voxel_grid.hpp>
+
+#include <env/env.hpp>
+
+#include <scenarios/platforms.hpp>
+
+
+namespace Megaverse
+{
+
+/**
+ * Everything a procedural scenario generates in reset(): the voxel layout, terrain and the spawn positions.
+ * This is what we store in level cache files, so that reset() can decode a level instead of generating it.
+ */
+struct Level
+{
+    struct Voxel
+    {
+        VoxelCoords coords;
+        uint8_t voxelType{}, terrain{};
+        ColorRgb color{};
+    };
+
+    struct TerrainBox
+    {
+        TerrainType type{};
+        BoundingBox bb;
+    };
+
+    void clear()
+    {
+        voxels.clear(), terrainBoxes.clear();
+        agentPositions.clear();
+        objectPositions.clear(), rewardPositions.clear();
+        ints.clear();
+    }
+
+public:
+    std::vector<Voxel> voxels;
+    std::vector<TerrainBox> terrainBoxes;
+    std::vector<Magnum::Vector3> agentPositions;
+    std::vector<VoxelCoords> objectPositions, rewardPositions;
+
+    // scenario-specific values, e.g. the number of platforms in Obstacles
+    std::vector<int> ints;
+};
+
+/**
+ * Scenarios that can save the generated layout and restore it from the level cache.
+ */
+class CacheableScenario
+{
+public:
+    virtual ~CacheableScenario() = default;
+
+    /**
+     * Capture the level generated by the last reset().
+     */
+    virtual void saveLevel(Level &level) const = 0;
+
+    /**
+     * Called from reset() instead of generating the level, after the components are reset.
+     */
+    virtual void loadLevel(const Level &level) = 0;
+};
+
+/**
+ * Appends levels to a level cache file. Records are written as they are added, only the index of record offsets is
+ * kept in memory until finish().
+ */
+class LevelCacheWriter
+{
+public:
+    LevelCacheWriter(const std::string &filename, const std::string &scenarioName);
+
+    ~LevelCacheWriter();
+
+    void add(const Level &level);
+
+    /**
+     * Write the index and the final header. Called by the destructor if not called explicitly.
+     */
+    void finish();
+
+    size_t size() const { return offsets.size(); }
+
+private:
+    std::ofstream file;
+    std::vector<uint64_t> offsets;
+    std::vector<char> buffer;
+    uint32_t scenarioNameLength = 0;
+    bool finished = false;
+};
+
+/**
+ * Read-only memory-mapped level cache file. Decoding a level touches only the pages of its record, so files with
+ * millions of levels are cheap to open, and the OS shares the pages between all envs of the process.
+ */
+class LevelCache
+{
+public:
+    explicit LevelCache(const std::string &filename);
+
+    ~LevelCache();
+
+    LevelCache(const LevelCache &) = delete;
+    LevelCache & operator=(const LevelCache &) = delete;
+
+    /**
+     * Files are mapped once and stay mapped until the process exits, envs opening the same file share the mapping.
+     */
+    static std::shared_ptr<const LevelCache> open(const std::string &filename);
+
+    size_t size() const { return numLevels; }
+
+    const std::string & getScenarioName() const { return scenarioName; }
+
+    void decode(size_t levelIdx, Level &level) const;
+
+private:
+    const char *data = nullptr;
+    size_t fileSize = 0;
+
+    size_t numLevels = 0;
+    const char *index = nullptr;
+    std::string scenarioName;
+};
+
+/**
+ * Use in reset() of a CacheableScenario: if a level cache is configured for the env (see Env::setLevelCachePath())
+ * this decodes a random level from it into the scenario.
+ * @return false if the level has to be generated as usual.
+ */
+bool loadCachedLevel(Env &env, Env::EnvState &envState, CacheableScenario &scenario);
+
+}
@@ -134,10 +134,25 @@ public:
 };
 
 
+/**
+ * Difficulty of the obstacle courses, see ObstaclesScenario. Sizes are in voxels.
+ */
+struct ObstaclesParams
+{
+    int minNumPlatforms = 1, maxNumPlatforms = 2;
+    int minGap = 1, maxGap = 2;
+    int minLava = 1, maxLava = 4;
+    int minHeight = 1, maxHeight = 3;
+
+    // how many obstacles of the max difficulty a level can have
+    int numAllowedMaxDifficulty = 1;
+};
+
+
 class Platform
 {
 public:
-    explicit Platform(Object3D *parent, Rng &rng, int walls, const FloatParams &params)
+    explicit Platform(Object3D *parent, Rng &rng, int walls, const ObstaclesParams &params)
     : rng{rng}
     , walls{walls}
     , root{&parent->addChild<Object3D>()}
@@ -275,11 +290,6 @@ public:
         return coords;
     }
 
-    int param(const std::string &str) const
-    {
-        return int(lround(params.at(str)));
-    }
-
     virtual bool isMaxDifficulty() const { return false; }
 
 public:
@@ -300,13 +310,13 @@ public:
 
     std::map<std::pair<int, int>, int> occupancy;
 
-    const FloatParams &params;
+    ObstaclesParams params;
 };
 
 class EmptyPlatform : public Platform
 {
 public:
-    explicit EmptyPlatform(Object3D *parent, Rng &rng, int walls, const FloatParams &params, int w = -1)
+    explicit EmptyPlatform(Object3D *parent, Rng &rng, int walls, const ObstaclesParams &params, int w = -1)
         : Platform{parent, rng, walls, params}
     {
         width = w;
@@ -332,7 +342,7 @@ public:
 class WallPlatform : public EmptyPlatform
 {
 public:
-    explicit WallPlatform(Object3D *parent, Rng &rng, int walls, const FloatParams &params, int w = -1)
+    explicit WallPlatform(Object3D *parent, Rng &rng, int walls, const ObstaclesParams &params, int w = -1)
         : EmptyPlatform{parent, rng, walls, params, w}
     {
     }
@@ -341,7 +351,7 @@ public:
     {
         EmptyPlatform::init();
 
-        wallHeight = randRange(param(Str::obstaclesMinHeight), param(Str::obstaclesMaxHeight) + 1, rng);
+        wallHeight = randRange(params.minHeight, params.maxHeight + 1, rng);
         height = randRange(wallHeight + 4, wallHeight + 6, rng);
     }
 
@@ -365,7 +375,7 @@ public:
 
     bool isMaxDifficulty() const override
     {
-        return wallHeight >= param(Str::obstaclesMaxHeight);
+        return wallHeight >= params.maxHeight;
     }
 
 private:
@@ -375,7 +385,7 @@ private:
 class LavaPlatform : public EmptyPlatform
 {
 public:
-    explicit LavaPlatform(Object3D *parent, Rng &rng, int walls, const FloatParams &params, int w = -1)
+    explicit LavaPlatform(Object3D *parent, Rng &rng, int walls, const ObstaclesParams &params, int w = -1)
         : EmptyPlatform{parent, rng, walls, params, w}
     {
     }
@@ -384,8 +394,8 @@ public:
     {
         EmptyPlatform::init();
         length = randRange(6, 12, rng);
-        auto minLava = std::min(param(Str::obstaclesMinLava), length - 2);
-        auto maxLava = std::min(param(Str::obstaclesMaxLava) + 1, length - 1);
+        auto minLava = std::min(params.minLava, length - 2);
+        auto maxLava = std::min(params.maxLava + 1, length - 1);
         lavaLength = randRange(minLava, maxLava, rng);
     }
 
@@ -401,7 +411,7 @@ public:
 
     int requiresMovableBoxesToTraverse() override { return std::max(1, lavaLength - 1); }
 
-    bool isMaxDifficulty() const override { return lavaLength >= param(Str::obstaclesMaxLava); }
+    bool isMaxDifficulty() const override { return lavaLength >= params.maxLava; }
 
 private:
     int lavaLength{};
@@ -410,7 +420,7 @@ private:
 class StepPlatform : public EmptyPlatform
 {
 public:
-    explicit StepPlatform(Object3D *parent, Rng &rng, int walls, const FloatParams &params, int w = -1)
+    explicit StepPlatform(Object3D *parent, Rng &rng, int walls, const ObstaclesParams &params, int w = -1)
         : EmptyPlatform{parent, rng, walls, params, w}
     {
     }
@@ -419,7 +429,7 @@ public:
     {
         EmptyPlatform::init();
 
-        stepHeight = randRange(param(Str::obstaclesMinHeight), param(Str::obstaclesMaxHeight) + 1, rng);
+        stepHeight = randRange(params.minHeight, params.maxHeight + 1, rng);
         height = randRange(stepHeight + 2, stepHeight + 5, rng);
     }
 
@@ -449,7 +459,7 @@ public:
 
     bool isMaxDifficulty() const override
     {
-        return stepHeight >= param(Str::obstaclesMaxHeight);
+        return stepHeight >= params.maxHeight;
     }
 
 private:
@@ -460,7 +470,7 @@ private:
 class GapPlatform : public EmptyPlatform
 {
 public:
-    explicit GapPlatform(Object3D *parent, Rng &rng, int walls, const FloatParams &params, int w = -1)
+    explicit GapPlatform(Object3D *parent, Rng &rng, int walls, const ObstaclesParams &params, int w = -1)
         : EmptyPlatform{parent, rng, walls, params, w}
     {
     }
@@ -469,7 +479,7 @@ public:
     {
         EmptyPlatform::init();
 
-        gap = randRange(param(Str::obstaclesMinGap), std::min(param(Str::obstaclesMaxGap) + 1, length - 1), rng);
+        gap = randRange(params.minGap, std::min(params.maxGap + 1, length - 1), rng);
         gapX = randRange(1, length - gap, rng);
     }
 
@@ -516,7 +526,7 @@ private:
 class StartPlatform : public EmptyPlatform
 {
 public:
-    explicit StartPlatform(Object3D *parent, Rng &rng, const FloatParams &params, int w = -1)
+    explicit StartPlatform(Object3D *parent, Rng &rng, const ObstaclesParams &params, int w = -1)
         : EmptyPlatform{parent, rng, WALLS_SOUTH | WALLS_EAST | WALLS_WEST, params, w}
     {
     }
@@ -530,7 +540,7 @@ public:
 class ExitPlatform : public EmptyPlatform
 {
 public:
-    explicit ExitPlatform(Object3D *parent, Rng &rng, const FloatParams &params, int w = -1)
+    explicit ExitPlatform(Object3D *parent, Rng &rng, const ObstaclesParams &params, int w = -1)
         : EmptyPlatform{parent, rng, WALLS_NORTH | WALLS_EAST | WALLS_WEST, params, w}
     {
     }
@@ -547,7 +557,7 @@ public:
 class TransitionPlatform : public EmptyPlatform
 {
 public:
-    explicit TransitionPlatform(Object3D *parent, Rng &rng, int walls, const FloatParams &params, int l, int w)
+    explicit TransitionPlatform(Object3D *parent, Rng &rng, int walls, const ObstaclesParams &params, int l, int w)
         : EmptyPlatform{parent, rng, walls, params, -1}
     {
         length = l, width = w;
@@ -73,12 +73,11 @@ public:
 
     void initializeDefaultParameters() override
     {
-        auto &fp = floatParams;
-        fp[Str::episodeLengthSec] = 300.0f;
-        fp[Str::verticalLookLimitRad] = 0.75f;
+        params.episodeLengthSec = 300.0f;
+        params.verticalLookLimitRad = 0.75f;
     }
 
-    RewardShaping defaultRewardShaping() const override
+    RewardDefaults defaultRewardShaping() const override
     {
         return {
             {Str::boxagoneTouchedFloor,  -0.1f},
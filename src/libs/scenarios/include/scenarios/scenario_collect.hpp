@@ -1,5 +1,6 @@
 #pragma once
 
+#include <scenarios/level_cache.hpp>
 #include <scenarios/scenario_default.hpp>
 #include <scenarios/layout_utils.hpp>
 #include <scenarios/component_voxel_grid.hpp>
@@ -17,7 +18,7 @@ struct VoxelCollect : public VoxelWithPhysicsObjects
 };
 
 
-class CollectScenario : public DefaultScenario, public ObjectStackingCallbacks, public FallDetectionCallbacks
+class CollectScenario : public DefaultScenario, public ObjectStackingCallbacks, public FallDetectionCallbacks, public CacheableScenario
 {
 public:
     explicit CollectScenario(const std::string &name, Env &env, Env::EnvState &envState);
@@ -37,9 +38,20 @@ public:
 
     void addEpisodeDrawables(DrawablesMap &drawables) override;
 
+    bool supportsSnapshots() const override { return true; }
+
+    void saveState(SnapshotWriter &writer) const override;
+
+    void loadState(SnapshotReader &reader) override;
+
+    // CacheableScenario interface
+    void saveLevel(Level &level) const override;
+
+    void loadLevel(const Level &level) override;
+
     float trueObjective(int /*agentIdx*/) const override { return solved; }
 
-    RewardShaping defaultRewardShaping() const override
+    RewardDefaults defaultRewardShaping() const override
     {
         return {
             {Str::collectSingleGood, 1.0f},
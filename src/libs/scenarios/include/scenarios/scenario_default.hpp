@@ -80,13 +80,13 @@ public:
     void spawnAgents(std::vector<AbstractAgent *> &agents) override
     {
         const auto numAgents = env.getNumAgents();
-        const auto verticalLookLimitRad = floatParams[Str::verticalLookLimitRad];
+        const auto verticalLookLimitRad = params.verticalLookLimitRad;
         const auto agentPositions = agentStartingPositions();
 
         for (int i = 0; i < numAgents; ++i) {
             auto randomRotation = frand(envState.rng) * Magnum::Constants::pi() * 2;
             auto &agent = envState.scene->addChild<DefaultKinematicAgent>(
-                envState.scene.get(), envState.physics->bWorld,
+                envState.scene.get(), envState.physics->bWorld, envState.agentControls,
                 Magnum::Vector3{agentPositions[i]} + Magnum::Vector3{0.5, 0.0, 0.5},
                 randomRotation, verticalLookLimitRad
             );
@@ -144,7 +144,7 @@ public:
             drawables[DrawableType::Box].emplace_back(&remainingTimeBar, rgb(ColorRgb::BLUE));
             defaultUI.remainingTimeBars[i] = UIElement{&remainingTimeBarAnchor, &remainingTimeBar};
 
-            if (floatParams[Str::useUIRewardIndicators] > 0) {
+            if (params.useUIRewardIndicators) {
                 auto addRewardIndicator = [&](float xOffset, ColorRgb color, std::vector<UIElement> &container) {
                     auto &indicatorAnchor = uiObject.addChild<Object3D>();
                     indicatorAnchor.translate({xOffset, 0, 0});
@@ -168,7 +168,7 @@ public:
             auto &bar = defaultUI.remainingTimeBars[i];
             bar.rescale({env.remainingTimeFraction() * defaultUI.initialRemainingTimeBarScale, 0.0015, 0.001});
 
-            if (floatParams[Str::useUIRewardIndicators] > 0) {
+            if (params.useUIRewardIndicators) {
                 if (envState.lastReward[i] > FLT_EPSILON) {
                     defaultUI.positiveRewardIndicator[i].show();
                     defaultUI.positiveRewardIndicator[i].rescale({0.06, 0.04f * envState.lastReward[i], 0.0001});
@@ -185,6 +185,21 @@ public:
         }
     }
 
+    void saveState(SnapshotWriter &writer) const override
+    {
+        // anchors are moved by the scene graph snapshot, only the flags are left
+        for (const auto elements : {&defaultUI.positiveRewardIndicator, &defaultUI.negativeRewardIndicator})
+            for (const auto &e : *elements)
+                writer.write(e.visible);
+    }
+
+    void loadState(SnapshotReader &reader) override
+    {
+        for (const auto elements : {&defaultUI.positiveRewardIndicator, &defaultUI.negativeRewardIndicator})
+            for (auto &e : *elements)
+                reader.read(e.visible);
+    }
+
     std::vector<Magnum::Color3> getPalette() const override
     {
         std::vector<Magnum::Color3> palette;
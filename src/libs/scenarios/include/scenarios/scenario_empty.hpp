@@ -18,13 +18,15 @@ public:
 
     void step() override {}
 
+    bool supportsSnapshots() const override { return true; }
+
     std::vector<Magnum::Vector3> agentStartingPositions() override;
 
     void addEpisodeDrawables(DrawablesMap &drawables) override;
 
     float trueObjective(int) const override { return 0; }
 
-    RewardShaping defaultRewardShaping() const override { return {}; }
+    RewardDefaults defaultRewardShaping() const override { return {}; }
 };
 
 }
\ No newline at end of file
@@ -30,7 +30,7 @@ public:
 
     float trueObjective(int) const override { return 0; }//TODO
 
-    RewardShaping defaultRewardShaping() const override { return {}; }
+    RewardDefaults defaultRewardShaping() const override { return {}; }
 
 private:
     VoxelGridComponent<VoxelState> vg;
@@ -24,7 +24,7 @@ public:
 
     [[nodiscard]] float trueObjective(int) const override { return solved; }
 
-    RewardShaping defaultRewardShaping() const override
+    RewardDefaults defaultRewardShaping() const override
     {
         return {{Str::exploreSolved, 5.0f}};
     }
@@ -40,7 +40,7 @@ public:
 
     [[nodiscard]] float trueObjective(int /*agentIdx*/) const override { return solved; }
 
-    RewardShaping defaultRewardShaping() const override
+    RewardDefaults defaultRewardShaping() const override
     {
         return {
             {Str::memoryCollectGood, 1.0f},
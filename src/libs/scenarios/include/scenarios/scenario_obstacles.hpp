@@ -1,6 +1,7 @@
 #pragma once
 
 #include <scenarios/platforms.hpp>
+#include <scenarios/level_cache.hpp>
 #include <scenarios/scenario_default.hpp>
 #include <scenarios/layout_utils.hpp>
 #include <scenarios/component_platforms.hpp>
@@ -19,7 +20,7 @@ struct VoxelObstacles : public VoxelWithPhysicsObjects
     Object3D *rewardObject = nullptr;
 };
 
-class ObstaclesScenario : public DefaultScenario, public ObjectStackingCallbacks, public FallDetectionCallbacks
+class ObstaclesScenario : public DefaultScenario, public ObjectStackingCallbacks, public FallDetectionCallbacks, public CacheableScenario
 {
 public:
     explicit ObstaclesScenario(const std::string &name, Env &env, Env::EnvState &envState);
@@ -35,7 +36,7 @@ public:
 
     float trueObjective(int) const override { return solved; }
 
-    RewardShaping defaultRewardShaping() const override
+    RewardDefaults defaultRewardShaping() const override
     {
         return {
             {Str::obstaclesAgentAtExit, 1.0f},
@@ -50,21 +51,26 @@ public:
         DefaultScenario::initializeDefaultParameters();
 
         platformTypes = {PlatformType::WALL, PlatformType::LAVA, PlatformType::STEP, PlatformType::GAP};
+    }
 
-        auto &fp = floatParams;
-        fp[Str::obstaclesMinNumPlatforms] = 1;
-        fp[Str::obstaclesMaxNumPlatforms] = 2;
-
-        fp[Str::obstaclesMinGap] = 1;
-        fp[Str::obstaclesMaxGap] = 2;
-
-        fp[Str::obstaclesMinLava] = 1;
-        fp[Str::obstaclesMaxLava] = 4;
-
-        fp[Str::obstaclesMinHeight] = 1;
-        fp[Str::obstaclesMaxHeight] = 3;
-
-        fp[Str::obstaclesNumAllowedMaxDifficulty] = 1;
+    std::vector<ParamField> parameterFields() override
+    {
+        auto fields = DefaultScenario::parameterFields();
+
+        auto &p = obstaclesParams;
+        fields.insert(fields.end(), {
+            {Str::obstaclesMinNumPlatforms, p.minNumPlatforms},
+            {Str::obstaclesMaxNumPlatforms, p.maxNumPlatforms},
+            {Str::obstaclesMinGap, p.minGap},
+            {Str::obstaclesMaxGap, p.maxGap},
+            {Str::obstaclesMinLava, p.minLava},
+            {Str::obstaclesMaxLava, p.maxLava},
+            {Str::obstaclesMinHeight, p.minHeight},
+            {Str::obstaclesMaxHeight, p.maxHeight},
+            {Str::obstaclesNumAllowedMaxDifficulty, p.numAllowedMaxDifficulty},
+        });
+
+        return fields;
     }
 
     float episodeLengthSec() const override;
@@ -73,8 +79,20 @@ public:
 
     void agentFell(int agentIdx) override;
 
+    bool supportsSnapshots() const override { return true; }
+
+    void saveState(SnapshotWriter &writer) const override;
+
+    void loadState(SnapshotReader &reader) override;
+
+    // CacheableScenario interface
+    void saveLevel(Level &level) const override;
+
+    void loadLevel(const Level &level) override;
+
 protected:
     std::vector<PlatformType> platformTypes;
+    ObstaclesParams obstaclesParams;
 
 private:
     VoxelGridComponent<VoxelObstacles> vg;
@@ -85,6 +103,9 @@ private:
     std::vector<VoxelCoords> objectSpawnPositions, rewardSpawnPositions;
     std::vector<Magnum::Vector3> agentSpawnPositions;
 
+    // terrain of all platforms, kept separately because cached levels have no platforms
+    std::vector<Level::TerrainBox> terrainBoxes;
+
     std::vector<bool> agentReachedExit;
     bool solved = false;
 
@@ -103,10 +124,10 @@ public:
     {
         ObstaclesScenario::initializeDefaultParameters();
 
-        auto &fp = floatParams;
-        fp[Str::obstaclesMinNumPlatforms] = 0;
-        fp[Str::obstaclesMaxNumPlatforms] = 0;
-        fp[Str::episodeLengthSec] = 6.0f;
+        auto &p = obstaclesParams;
+        p.minNumPlatforms = 0;
+        p.maxNumPlatforms = 0;
+        params.episodeLengthSec = 6.0f;
     }
 };
 
@@ -122,18 +143,18 @@ public:
     {
         ObstaclesScenario::initializeDefaultParameters();
 
-        auto &fp = floatParams;
-        fp[Str::obstaclesMinNumPlatforms] = 1;
-        fp[Str::obstaclesMaxNumPlatforms] = 2;
+        auto &p = obstaclesParams;
+        p.minNumPlatforms = 1;
+        p.maxNumPlatforms = 2;
 
-        fp[Str::obstaclesMinGap] = 1;
-        fp[Str::obstaclesMaxGap] = 2;
+        p.minGap = 1;
+        p.maxGap = 2;
 
-        fp[Str::obstaclesMinLava] = 1;
-        fp[Str::obstaclesMaxLava] = 4;
+        p.minLava = 1;
+        p.maxLava = 4;
 
-        fp[Str::obstaclesMinHeight] = 1;
-        fp[Str::obstaclesMaxHeight] = 3;
+        p.minHeight = 1;
+        p.maxHeight = 3;
     }
 };
 
@@ -149,15 +170,15 @@ public:
     {
         ObstaclesScenario::initializeDefaultParameters();
 
-        auto &fp = floatParams;
-        fp[Str::obstaclesMinNumPlatforms] = 2;
-        fp[Str::obstaclesMaxNumPlatforms] = 4;
+        auto &p = obstaclesParams;
+        p.minNumPlatforms = 2;
+        p.maxNumPlatforms = 4;
 
-        fp[Str::obstaclesMinLava] = 2;
-        fp[Str::obstaclesMaxLava] = 5;
+        p.minLava = 2;
+        p.maxLava = 5;
 
-        fp[Str::obstaclesMinHeight] = 1;
-        fp[Str::obstaclesMaxHeight] = 3;
+        p.minHeight = 1;
+        p.maxHeight = 3;
     }
 };
 
@@ -173,18 +194,18 @@ public:
     {
         ObstaclesScenario::initializeDefaultParameters();
 
-        auto &fp = floatParams;
-        fp[Str::obstaclesMinNumPlatforms] = 2;
-        fp[Str::obstaclesMaxNumPlatforms] = 7;
+        auto &p = obstaclesParams;
+        p.minNumPlatforms = 2;
+        p.maxNumPlatforms = 7;
 
-        fp[Str::obstaclesMinGap] = 2;
-        fp[Str::obstaclesMaxGap] = 3;
+        p.minGap = 2;
+        p.maxGap = 3;
 
-        fp[Str::obstaclesMinLava] = 3;
-        fp[Str::obstaclesMaxLava] = 10;
+        p.minLava = 3;
+        p.maxLava = 10;
 
-        fp[Str::obstaclesMinHeight] = 2;
-        fp[Str::obstaclesMaxHeight] = 4;
+        p.minHeight = 2;
+        p.maxHeight = 4;
     }
 };
 
@@ -196,10 +217,10 @@ public:
     {
     }
 
-    RewardShaping defaultRewardShaping() const override
+    RewardDefaults defaultRewardShaping() const override
     {
         auto shaping = ObstaclesScenario::defaultRewardShaping();
-        shaping[Str::obstaclesAgentCarriedObjectToExit] = 1.0f;
+        shaping.emplace_back(Str::obstaclesAgentCarriedObjectToExit, 1.0f);  // replaces the default value
         return shaping;
     }
 
@@ -207,18 +228,18 @@ public:
     {
         ObstaclesScenario::initializeDefaultParameters();
 
-        auto &fp = floatParams;
-        fp[Str::obstaclesMinNumPlatforms] = 1;
-        fp[Str::obstaclesMaxNumPlatforms] = 4;
+        auto &p = obstaclesParams;
+        p.minNumPlatforms = 1;
+        p.maxNumPlatforms = 4;
 
-        fp[Str::obstaclesMinGap] = 1;
-        fp[Str::obstaclesMaxGap] = 3;
-        fp[Str::obstaclesMinLava] = 2;
-        fp[Str::obstaclesMaxLava] = 10;
-        fp[Str::obstaclesMinHeight] = 1;
-        fp[Str::obstaclesMaxHeight] = 3;
+        p.minGap = 1;
+        p.maxGap = 3;
+        p.minLava = 2;
+        p.maxLava = 10;
+        p.minHeight = 1;
+        p.maxHeight = 3;
 
-        fp[Str::obstaclesNumAllowedMaxDifficulty] = 1;
+        p.numAllowedMaxDifficulty = 1;
     }
 };
 
@@ -49,8 +49,8 @@ public:
 class ArrangementObject : public RigidBody
 {
 public:
-    ArrangementObject(Object3D *parent, Magnum::Float mass, btCollisionShape *bShape, btDynamicsWorld &bWorld)
-    : RigidBody{parent, mass, bShape, bWorld}
+    ArrangementObject(Object3D *parent, BoxShapeCache &boxShapes, btDynamicsWorld &bWorld)
+    : RigidBody{parent, boxShapes, bWorld}
     {
     }
 
@@ -94,7 +94,7 @@ public:
 
     float trueObjective(int /*agentIdx*/) const override { return solved; }
 
-    RewardShaping defaultRewardShaping() const override
+    RewardDefaults defaultRewardShaping() const override
     {
         return {
             {Str::rearrangeOneMoreObjectCorrectPosition, 1},
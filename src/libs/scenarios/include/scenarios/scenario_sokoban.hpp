@@ -38,7 +38,7 @@ public:
 
     float trueObjective(int) const override { return float(solved); }
 
-    RewardShaping defaultRewardShaping() const override
+    RewardDefaults defaultRewardShaping() const override
     {
         return {
             {Str::sokobanBoxOnTarget, 1.0f},
@@ -50,7 +50,7 @@ public:
     void initializeDefaultParameters() override
     {
         DefaultScenario::initializeDefaultParameters();
-        floatParams[Str::episodeLengthSec] = 80.0f;
+        params.episodeLengthSec = 80.0f;
     }
 
 private:
@@ -41,7 +41,7 @@ public:
 
     float trueObjective(int) const override { return float(highestTower); }
 
-    RewardShaping defaultRewardShaping() const override
+    RewardDefaults defaultRewardShaping() const override
     {
         return {
             {Str::teamSpirit, 0.1f},  // replaces the default value
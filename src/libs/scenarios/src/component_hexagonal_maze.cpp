@@ -88,35 +88,33 @@ void HexagonalMazeComponent::addDrawablesAndCollisions(DrawablesMap &drawables,
                 rotationY = -atanf(tanAlpha);
             }
 
-            auto &layoutBox = envState.scene->addChild<Object3D>();
+            auto &layoutBox = envState.addChild(*envState.scene);
             if (frand(envState.rng) < wallLandmarkProbability) {
                 const auto landmarkWidth = 0.15f, landmarkHeight = landmarkWidth * length / wallHeight;
 
                 int numLandmarks = randRange(2, 5, envState.rng);
                 for (int li = 0; li < numLandmarks; ++li) {
                     const Vector3 landmarkScale{landmarkWidth, landmarkHeight, frand(envState.rng) * 1.2f + 1.5f};
-                    auto &landmarkBox = layoutBox.addChild<Object3D>();
+                    auto &landmarkBox = envState.addChild(layoutBox);
                     const Vector3 landmarkTranslation{float(li % 2 == 1) * landmarkWidth * 2, float(li > 1) * landmarkHeight * 2 - 0.2f, 0};
                     landmarkBox.scaleLocal(landmarkScale).translate(landmarkTranslation);
-                    drawables[DrawableType::Box].emplace_back(&landmarkBox, rgb(sampleRandomColor(envState.rng)));
+                    drawables[DrawableType::Box].emplace_back(&landmarkBox, rgb(sampleRandomColor(envState.rng)), true);
                 }
             }
 
             layoutBox.scale(wallScale).rotateY(Rad(rotationY)).translate(wallTranslation);
-            drawables[DrawableType::Box].emplace_back(&layoutBox, rgb(ColorRgb::DARK_BLUE));
+            drawables[DrawableType::Box].emplace_back(&layoutBox, rgb(ColorRgb::DARK_BLUE), true);
 
-            auto bBoxShape = std::make_unique<btBoxShape>(btVector3{1, 1, 1});
-            auto &collisionBox = layoutBox.addChild<RigidBody>(envState.scene.get(), 0.0f, bBoxShape.get(), envState.physics->bWorld);
+            auto &collisionBox = envState.addChild<RigidBody>(layoutBox, envState.physics->boxShapes, envState.physics->bWorld);
             collisionBox.syncPose();
-            envState.physics->collisionShapes.emplace_back(std::move(bBoxShape));
 
             // top and bottom edging
             {
-                auto &bottomEdgingBox = envState.scene->addChild<Object3D>();
+                auto &bottomEdgingBox = envState.addChild(*envState.scene);
                 const Vector3 edgingScale{length * 1.02f, wallHeight * 0.12f, 0.2f};
                 const Vector3 bottomEdgingTranslation{wallTranslation.x(), edgingScale.y(), wallTranslation.z()};
                 bottomEdgingBox.scale(edgingScale).rotateY(Rad(rotationY)).translate(bottomEdgingTranslation);
-                drawables[DrawableType::Box].emplace_back(&bottomEdgingBox, rgb(bottomEdgingColor));
+                drawables[DrawableType::Box].emplace_back(&bottomEdgingBox, rgb(bottomEdgingColor), true);
 
 //                auto &topEdgingBox = envState.scene->addChild<Object3D>();
 //                const Vector3 topEdgingTranslation{wallTranslation.x(), wallHeight * 2, wallTranslation.z()};
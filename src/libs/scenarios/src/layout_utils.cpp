@@ -13,12 +13,58 @@ using namespace Magnum::Math::Literals;
 using namespace Megaverse;
 
 
+namespace
+{
+
+/**
+ * One static rigid body per box. RigidBody::syncPose() picks the shared shape matching the size of the box.
+ */
+void addStaticBoxBody(Env::EnvState &envState, Object3D &box)
+{
+    auto &collisionBox = envState.addChild<RigidBody>(box, envState.physics->boxShapes, envState.physics->bWorld);
+    collisionBox.syncPose();
+}
+
+/**
+ * Add the box as a child of the merged static layout shape, creating the layout body on first use.
+ * Call updateStaticLayoutAabb() after adding the boxes.
+ */
+void addMergedStaticBox(Env::EnvState &envState, const Vector3 &scale, const Vector3 &translation)
+{
+    auto &physics = *envState.physics;
+
+    if (!physics.staticLayoutShape) {
+        auto layoutShape = std::make_unique<btCompoundShape>();
+        physics.staticLayoutBody = &envState.addChild<RigidBody>(*envState.scene, 0.0f, layoutShape.get(), physics.bWorld);
+        physics.staticLayoutShape = layoutShape.get();
+        physics.collisionShapes.emplace_back(std::move(layoutShape));
+    }
+
+    auto bBoxShape = physics.boxShapes.get(btVector3{scale});
+    physics.staticLayoutShape->addChildShape(btTransform{btMatrix3x3::getIdentity(), btVector3{translation}}, bBoxShape);
+}
+
+/**
+ * The layout body is already in the world while the compound grows, so its broadphase AABB has to be refreshed.
+ */
+void updateStaticLayoutAabb(Env::EnvState &envState)
+{
+    auto &physics = *envState.physics;
+    if (physics.staticLayoutBody)
+        physics.bWorld.updateSingleAabb(&physics.staticLayoutBody->rigidBody());
+}
+
+}
+
+
 // TODO: add different types of layouts
 void Megaverse::addBoundingBoxes(DrawablesMap &drawables, Env::EnvState &envState, const Boxes &boxes, int voxelType, ColorRgb color, float voxelSize)
 {
     if (voxelType == VOXEL_EMPTY)
         return;
 
+    const bool merged = envState.mergeStaticGeometry;
+
     for (auto box : boxes) {
         const auto bboxMin = box.min, bboxMax = box.max;
         auto scale = Magnum::Vector3{
@@ -33,21 +79,24 @@ void Megaverse::addBoundingBoxes(DrawablesMap &drawables, Env::EnvState &envStat
             float((bboxMin.z() + bboxMax.z())) / 2 + 0.5f
         } * voxelSize;
 
-        auto &layoutBox = envState.scene->addChild<Object3D>();
-        layoutBox.scale(scale).translate(translation);
+        // with merged collisions the scene object is only needed for drawing
+        if ((voxelType & VOXEL_OPAQUE) || (!merged && (voxelType & VOXEL_SOLID))) {
+            auto &layoutBox = envState.addChild(*envState.scene);
+            layoutBox.scale(scale).translate(translation);
 
-        if (voxelType & VOXEL_OPAQUE)
-            drawables[DrawableType::Box].emplace_back(&layoutBox, rgb(color));
+            if (voxelType & VOXEL_OPAQUE)
+                drawables[DrawableType::Box].emplace_back(&layoutBox, rgb(color), true);
 
-        if (voxelType & VOXEL_SOLID) {
-            auto bBoxShape = std::make_unique<btBoxShape>(btVector3{1,1,1});
-            auto &collisionBox = layoutBox.addChild<RigidBody>(envState.scene.get(), 0.0f, bBoxShape.get(), envState.physics->bWorld);
-
-            collisionBox.syncPose();
-
-            envState.physics->collisionShapes.emplace_back(std::move(bBoxShape));
+            if (!merged && (voxelType & VOXEL_SOLID))
+                addStaticBoxBody(envState, layoutBox);
         }
+
+        if (merged && (voxelType & VOXEL_SOLID))
+            addMergedStaticBox(envState, scale, translation);
     }
+
+    if (merged)
+        updateStaticLayoutAabb(envState);
 }
 
 void Megaverse::addTerrain(DrawablesMap &drawables, Env::EnvState &envState, TerrainType type, const BoundingBox &bb, float voxelSize)
@@ -58,12 +107,12 @@ void Megaverse::addTerrain(DrawablesMap &drawables, Env::EnvState &envState, Ter
         // otherwise we don't draw anything
         const auto pos = Magnum::Vector3(bb.min.x() * voxelSize + scale.x() / 2, bb.min.y() * voxelSize, bb.min.z() * voxelSize + scale.z() / 2);
 
-        auto &terrainObject = envState.scene->addChild<Object3D>(envState.scene.get());
+        auto &terrainObject = envState.addChild(*envState.scene);
         terrainObject.scale({0.5, 0.025, 0.5}).scale(scale);
         terrainObject.translate({0.0, 0.025, 0.0});
         terrainObject.translate(pos);
 
-        drawables[DrawableType::Box].emplace_back(&terrainObject, rgb(terrainColor(type)));
+        drawables[DrawableType::Box].emplace_back(&terrainObject, rgb(terrainColor(type)), true);
     }
 }
 
@@ -72,14 +121,16 @@ void Megaverse::addStaticCollidingBox(
     Vector3 scale, Vector3 translation, ColorRgb color
 )
 {
-    auto &layoutBox = envState.scene->addChild<Object3D>();
+    auto &layoutBox = envState.addChild(*envState.scene);
     layoutBox.scale(scale).translate(translation);
-    drawables[DrawableType::Box].emplace_back(&layoutBox, rgb(color));
+    drawables[DrawableType::Box].emplace_back(&layoutBox, rgb(color), true);
 
-    auto bBoxShape = std::make_unique<btBoxShape>(btVector3{1, 1, 1});
-    auto &collisionBox = layoutBox.addChild<RigidBody>(envState.scene.get(), 0.0f, bBoxShape.get(), envState.physics->bWorld);
-    collisionBox.syncPose();
-    envState.physics->collisionShapes.emplace_back(std::move(bBoxShape));
+    if (envState.mergeStaticGeometry) {
+        addMergedStaticBox(envState, scale, translation);
+        updateStaticLayoutAabb(envState);
+    } else {
+        addStaticBoxBody(envState, layoutBox);
+    }
 }
 
 Object3D * Megaverse::addCylinder(DrawablesMap &drawables, Object3D &parent, Magnum::Vector3 translation, Magnum::Vector3 scale, ColorRgb color)
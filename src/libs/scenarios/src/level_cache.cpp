@@ -0,0 +1,293 @@
+#include <map>
+#include <mutex>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <util/tiny_logger.hpp>
+#include <util/string_utils.hpp>
+
+#include <scenarios/level_cache.hpp>
+
+
+using namespace Megaverse;
+
+
+/**
+ * File layout (native byte order):
+ *   FileHeader, scenario name (scenarioNameLength bytes), level records, index (numLevels uint64 record offsets).
+ * Level record:
+ *   RecordHeader followed by the arrays in the order of its counters:
+ *   voxels (int16 x, y, z, uint8 voxelType, uint8 terrain, uint32 color), terrain boxes (uint8 type, int16 min xyz,
+ *   int16 max xyz), agent positions (float xyz), object and reward positions (int16 xyz), ints (int32).
+ */
+namespace
+{
+
+constexpr char levelCacheMagic[4] = {'M', 'V', 'L', 'C'};
+constexpr uint32_t levelCacheVersion = 1;
+
+struct FileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t numLevels;
+    uint64_t indexOffset;
+    uint32_t scenarioNameLength;
+    uint32_t reserved;
+};
+
+struct RecordHeader
+{
+    uint32_t numVoxels, numTerrainBoxes, numAgentPositions, numObjectPositions, numRewardPositions, numInts;
+};
+
+template<typename T>
+void write(std::vector<char> &buffer, T value)
+{
+    const auto offset = buffer.size();
+    buffer.resize(offset + sizeof(T));
+    memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+void writeCoords(std::vector<char> &buffer, const VoxelCoords &v)
+{
+    write(buffer, int16_t(v.x())), write(buffer, int16_t(v.y())), write(buffer, int16_t(v.z()));
+}
+
+/**
+ * Bounds-checked reads from the mapped file. Records are not aligned, hence memcpy.
+ */
+class Reader
+{
+public:
+    Reader(const char *begin, const char *end)
+    : ptr{begin}, end{end}
+    {
+    }
+
+    template<typename T>
+    T read()
+    {
+        TCHECK(ptr + sizeof(T) <= end) << "Level cache record is truncated";
+
+        T value;
+        memcpy(&value, ptr, sizeof(T));
+        ptr += sizeof(T);
+        return value;
+    }
+
+    VoxelCoords readCoords()
+    {
+        const auto x = read<int16_t>(), y = read<int16_t>(), z = read<int16_t>();
+        return {x, y, z};
+    }
+
+private:
+    const char *ptr, *end;
+};
+
+}
+
+
+LevelCacheWriter::LevelCacheWriter(const std::string &filename, const std::string &scenarioName)
+: file{filename, std::ios::out | std::ios::binary | std::ios::trunc}
+{
+    TCHECK(file.good()) << "Could not open " << filename << " for writing";
+
+    const auto name = toLower(scenarioName);
+    scenarioNameLength = uint32_t(name.size());
+
+    // the real header is written by finish()
+    FileHeader header{};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(name.data(), std::streamsize(name.size()));
+}
+
+LevelCacheWriter::~LevelCacheWriter()
+{
+    if (!finished)
+        finish();
+}
+
+void LevelCacheWriter::add(const Level &level)
+{
+    TCHECK(!finished);
+
+    buffer.clear();
+
+    const RecordHeader header{
+        uint32_t(level.voxels.size()), uint32_t(level.terrainBoxes.size()), uint32_t(level.agentPositions.size()),
+        uint32_t(level.objectPositions.size()), uint32_t(level.rewardPositions.size()), uint32_t(level.ints.size()),
+    };
+    write(buffer, header);
+
+    for (const auto &v : level.voxels) {
+        writeCoords(buffer, v.coords);
+        write(buffer, v.voxelType), write(buffer, v.terrain), write(buffer, uint32_t(v.color));
+    }
+
+    for (const auto &t : level.terrainBoxes) {
+        write(buffer, uint8_t(t.type));
+        writeCoords(buffer, t.bb.min), writeCoords(buffer, t.bb.max);
+    }
+
+    for (const auto &p : level.agentPositions)
+        write(buffer, p.x()), write(buffer, p.y()), write(buffer, p.z());
+
+    for (const auto &p : level.objectPositions)
+        writeCoords(buffer, p);
+    for (const auto &p : level.rewardPositions)
+        writeCoords(buffer, p);
+
+    for (auto i : level.ints)
+        write(buffer, int32_t(i));
+
+    offsets.emplace_back(uint64_t(file.tellp()));
+    file.write(buffer.data(), std::streamsize(buffer.size()));
+}
+
+void LevelCacheWriter::finish()
+{
+    if (finished)
+        return;
+
+    const auto indexOffset = uint64_t(file.tellp());
+    file.write(reinterpret_cast<const char *>(offsets.data()), std::streamsize(offsets.size() * sizeof(uint64_t)));
+
+    FileHeader header{};
+    memcpy(header.magic, levelCacheMagic, sizeof(levelCacheMagic));
+    header.version = levelCacheVersion;
+    header.numLevels = offsets.size();
+    header.indexOffset = indexOffset;
+    header.scenarioNameLength = scenarioNameLength;
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.close();
+
+    TCHECK(!file.fail()) << "Failed to write the level cache";
+    finished = true;
+}
+
+
+LevelCache::LevelCache(const std::string &filename)
+{
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    TCHECK(fd >= 0) << "Could not open level cache " << filename;
+
+    struct stat st{};
+    TCHECK(fstat(fd, &st) == 0) << "Could not stat " << filename;
+    fileSize = size_t(st.st_size);
+    TCHECK(fileSize >= sizeof(FileHeader)) << "Level cache " << filename << " is too small";
+
+    void *mapped = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    TCHECK(mapped != MAP_FAILED) << "Could not map level cache " << filename;
+
+    // levels are sampled at random
+    madvise(mapped, fileSize, MADV_RANDOM);
+
+    data = static_cast<const char *>(mapped);
+
+    FileHeader header{};
+    memcpy(&header, data, sizeof(header));
+    TCHECK(memcmp(header.magic, levelCacheMagic, sizeof(levelCacheMagic)) == 0) << filename << " is not a level cache";
+    TCHECK(header.version == levelCacheVersion) << "Unsupported level cache version " << header.version;
+    TCHECK(sizeof(FileHeader) + header.scenarioNameLength <= fileSize);
+    TCHECK(header.indexOffset + header.numLevels * sizeof(uint64_t) <= fileSize) << "Level cache " << filename << " is truncated";
+
+    scenarioName.assign(data + sizeof(FileHeader), header.scenarioNameLength);
+    numLevels = size_t(header.numLevels);
+    index = data + header.indexOffset;
+}
+
+LevelCache::~LevelCache()
+{
+    munmap(const_cast<char *>(data), fileSize);
+}
+
+std::shared_ptr<const LevelCache> LevelCache::open(const std::string &filename)
+{
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<const LevelCache>> openCaches;
+
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto &cache = openCaches[filename];
+    if (!cache)
+        cache = std::make_shared<const LevelCache>(filename);
+
+    return cache;
+}
+
+void LevelCache::decode(size_t levelIdx, Level &level) const
+{
+    TCHECK(levelIdx < numLevels);
+
+    uint64_t offset;
+    memcpy(&offset, index + levelIdx * sizeof(uint64_t), sizeof(offset));
+    TCHECK(offset < fileSize);
+
+    Reader reader{data + offset, data + fileSize};
+    const auto header = reader.read<RecordHeader>();
+
+    level.clear();
+
+    level.voxels.resize(header.numVoxels);
+    for (auto &v : level.voxels) {
+        v.coords = reader.readCoords();
+        v.voxelType = reader.read<uint8_t>(), v.terrain = reader.read<uint8_t>();
+        v.color = ColorRgb(reader.read<uint32_t>());
+    }
+
+    level.terrainBoxes.resize(header.numTerrainBoxes);
+    for (auto &t : level.terrainBoxes) {
+        t.type = TerrainType(reader.read<uint8_t>());
+        t.bb.min = reader.readCoords(), t.bb.max = reader.readCoords();
+    }
+
+    level.agentPositions.resize(header.numAgentPositions);
+    for (auto &p : level.agentPositions) {
+        const auto x = reader.read<float>(), y = reader.read<float>(), z = reader.read<float>();
+        p = Magnum::Vector3{x, y, z};
+    }
+
+    level.objectPositions.resize(header.numObjectPositions);
+    for (auto &p : level.objectPositions)
+        p = reader.readCoords();
+
+    level.rewardPositions.resize(header.numRewardPositions);
+    for (auto &p : level.rewardPositions)
+        p = reader.readCoords();
+
+    level.ints.resize(header.numInts);
+    for (auto &i : level.ints)
+        i = reader.read<int32_t>();
+}
+
+
+bool Megaverse::loadCachedLevel(Env &env, Env::EnvState &envState, CacheableScenario &scenario)
+{
+    const auto &filename = env.getLevelCachePath();
+    if (filename.empty())
+        return false;
+
+    const auto cache = LevelCache::open(filename);
+    TCHECK(cache->getScenarioName() == toLower(env.getScenarioName()))
+        << "Level cache " << filename << " contains levels of " << cache->getScenarioName() << ", not " << env.getScenarioName();
+    TCHECK(cache->size() > 0) << "Level cache " << filename << " is empty";
+
+    // one decode buffer per thread, to avoid reallocating the arrays on every reset
+    thread_local Level level;
+    cache->decode(size_t(randRange(0, int(cache->size()), envState.rng)), level);
+
+    TCHECK(int(level.agentPositions.size()) >= env.getNumAgents())
+        << "Levels in " << filename << " were generated for " << level.agentPositions.size() << " agents";
+
+    scenario.loadLevel(level);
+    return true;
+}
@@ -7,8 +7,8 @@ using namespace Megaverse;
 class BoxAGoneScenario::BoxAGonePlatform : public EmptyPlatform
 {
 public:
-    explicit BoxAGonePlatform(Object3D *parent, Rng &rng, int walls, const FloatParams &params, int)
-    : EmptyPlatform(parent, rng, walls, params)
+    explicit BoxAGonePlatform(Object3D *parent, Rng &rng, int walls, int)
+    : EmptyPlatform(parent, rng, walls, ObstaclesParams{})
     {
     }
 
@@ -51,7 +51,7 @@ void BoxAGoneScenario::reset()
     platformStates.clear();
     extraPlatforms.clear();
 
-    platform = std::make_unique<BoxAGonePlatform>(platformsComponent.levelRoot.get(), envState.rng, WALLS_ALL, floatParams, env.getNumAgents());
+    platform = std::make_unique<BoxAGonePlatform>(platformsComponent.levelRoot.get(), envState.rng, WALLS_ALL, env.getNumAgents());
     platform->init(), platform->generate();
     vg.addPlatform(*platform, ColorRgb::LAYOUT_DEFAULT, ColorRgb::LAYOUT_DEFAULT, true);
 
@@ -202,16 +202,12 @@ void BoxAGoneScenario::addDisappearingPlatforms(DrawablesMap &drawables)
     for (const auto &[pos, color] : disappearingPlatforms) {
         auto translation = Magnum::Vector3{float(pos.x()) + 0.5f, float(pos.y()) + 0.5f, float(pos.z()) + 0.5f} * voxelSize;
 
-        auto bBoxShape = std::make_unique<btBoxShape>(btVector3{1, 1, 1});
-
-        auto &object = envState.scene->addChild<RigidBody>(envState.scene.get(), 0.0f, bBoxShape.get(), envState.physics->bWorld);
+        auto &object = envState.addChild<RigidBody>(*envState.scene, envState.physics->boxShapes, envState.physics->bWorld);
         object.scale(objScale).translate(translation);
         object.syncPose();
 
         drawables[DrawableType::Box].emplace_back(&object, rgb(color));
 
-        envState.physics->collisionShapes.emplace_back(std::move(bBoxShape));
-
         VoxelBoxAGone voxelState;
         voxelState.disappearingPlatform = &object;
         vg.grid.set(pos, voxelState);
@@ -219,14 +215,11 @@ void BoxAGoneScenario::addDisappearingPlatforms(DrawablesMap &drawables)
 
     for (int i = 0; i < env.getNumAgents() * 3; ++i) {
         auto translation = Magnum::Vector3{300, 300, 300} * voxelSize;
-        auto bBoxShape = std::make_unique<btBoxShape>(btVector3{1, 1, 1});
-
-        auto &object = envState.scene->addChild<RigidBody>(envState.scene.get(), 0.0f, bBoxShape.get(), envState.physics->bWorld);
+        auto &object = envState.addChild<RigidBody>(*envState.scene, envState.physics->boxShapes, envState.physics->bWorld);
         object.scale(objScale).translate(translation);
         object.syncPose();
 
         drawables[DrawableType::Box].emplace_back(&object, rgb(ColorRgb::GREEN));
-        envState.physics->collisionShapes.emplace_back(std::move(bBoxShape));
 
         extraPlatforms.emplace_back(&object);
     }
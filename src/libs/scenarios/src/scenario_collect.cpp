@@ -27,7 +27,8 @@ void CollectScenario::reset()
 
     numPositiveRewards = positiveRewardsCollected = 0;
 
-    createLandscape();
+    if (!loadCachedLevel(env, envState, *this))
+        createLandscape();
 
     fallDetection.agentInitialPositions = agentPositions;
 }
@@ -211,6 +212,50 @@ void CollectScenario::addEpisodeDrawables(DrawablesMap &drawables)
     }
 }
 
+void CollectScenario::saveState(SnapshotWriter &writer) const
+{
+    DefaultScenario::saveState(writer);
+
+    vg.saveState(writer);
+    objectStackingComponent.saveState(writer);
+
+    writer.write(positiveRewardsCollected);
+    writer.write(solved);
+}
+
+void CollectScenario::loadState(SnapshotReader &reader)
+{
+    DefaultScenario::loadState(reader);
+
+    vg.loadState(reader);
+    objectStackingComponent.loadState(reader);
+
+    reader.read(positiveRewardsCollected);
+    reader.read(solved);
+}
+
+void CollectScenario::saveLevel(Level &level) const
+{
+    level.clear();
+
+    for (const auto &[coords, voxel] : vg.grid.getHashMap())
+        level.voxels.push_back({coords, voxel.voxelType, voxel.terrain, voxel.color});
+
+    level.agentPositions = agentPositions;
+    level.objectPositions = objectPositions;
+    level.rewardPositions = rewardPositions;
+}
+
+void CollectScenario::loadLevel(const Level &level)
+{
+    for (const auto &v : level.voxels)
+        vg.grid.set(v.coords, makeVoxel<VoxelCollect>(v.voxelType, v.terrain, v.color));
+
+    agentPositions = level.agentPositions;
+    objectPositions = level.objectPositions;
+    rewardPositions = level.rewardPositions;
+}
+
 void CollectScenario::agentFell(int agentIdx)
 {
     // this is just to help agents learn a bit faster
@@ -7,8 +7,8 @@ using namespace Megaverse;
 class FootballScenario::FootballLayout : public EmptyPlatform
 {
 public:
-    FootballLayout(Object3D *parent, Rng &rng, int walls, const FloatParams &params)
-    : EmptyPlatform{parent, rng, walls, params}
+    FootballLayout(Object3D *parent, Rng &rng, int walls)
+    : EmptyPlatform{parent, rng, walls, ObstaclesParams{}}
     {
     }
 
@@ -123,7 +123,7 @@ void FootballScenario::reset()
 
     footballObject = &object;
 
-    layout = std::make_unique<FootballLayout>(platformsComponent.levelRoot.get(), envState.rng, WALLS_ALL, floatParams);
+    layout = std::make_unique<FootballLayout>(platformsComponent.levelRoot.get(), envState.rng, WALLS_ALL);
     layout->init(), layout->generate();
     vg.addPlatform(*layout, ColorRgb::LAYOUT_DEFAULT, ColorRgb::LAYOUT_DEFAULT, true);
 }
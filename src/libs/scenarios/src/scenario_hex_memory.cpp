@@ -132,7 +132,7 @@ std::vector<Magnum::Vector3> HexMemoryScenario::agentStartingPositions()
 void HexMemoryScenario::spawnAgents(std::vector<AbstractAgent *> &agents)
 {
     const auto numAgents = env.getNumAgents();
-    const auto verticalLookLimitRad = floatParams[Str::verticalLookLimitRad];
+    const auto verticalLookLimitRad = params.verticalLookLimitRad;
     const auto agentPositions = agentStartingPositions();
 
     const auto rotationBetweenAgents = float(2 * M_PI / env.getNumAgents());
@@ -140,7 +140,7 @@ void HexMemoryScenario::spawnAgents(std::vector<AbstractAgent *> &agents)
     for (int i = 0; i < numAgents; ++i) {
         auto randomRotation = rotationBetweenAgents * i;
         auto &agent = envState.scene->addChild<DefaultKinematicAgent>(
-            envState.scene.get(), envState.physics->bWorld,
+            envState.scene.get(), envState.physics->bWorld, envState.agentControls,
             Magnum::Vector3{agentPositions[i]} + Magnum::Vector3{0.5, 0.0, 0.5},
             randomRotation, verticalLookLimitRad
         );
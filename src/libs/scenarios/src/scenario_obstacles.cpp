@@ -16,7 +16,7 @@ namespace
 
 std::unique_ptr<Platform> makePlatform(
     const std::vector<PlatformType> &platformTypes, Object3D *parent, Rng &rng,
-    int walls, const FloatParams &params, int width
+    int walls, const ObstaclesParams &params, int width
 )
 {
     const auto platformType = randomSample(platformTypes, rng);
@@ -56,9 +56,13 @@ void ObstaclesScenario::reset()
     fallDetection.reset(env, envState);
 
     agentSpawnPositions.clear(), objectSpawnPositions.clear(), rewardSpawnPositions.clear();
+    terrainBoxes.clear();
     agentReachedExit = std::vector<bool>(env.getNumAgents(), false);
     solved = false;
 
+    if (loadCachedLevel(env, envState, *this))
+        return;
+
     auto &platforms = platformsComponent.platforms;
 
     const bool drawWalls = randRange(0, 2, envState.rng);
@@ -69,15 +73,11 @@ void ObstaclesScenario::reset()
     for (int attempt = 0; attempt < 20; ++attempt) {
         platforms.clear();
 
-        numPlatforms = randRange(
-            int(lround(floatParams[Str::obstaclesMinNumPlatforms])),
-            int(lround(floatParams[Str::obstaclesMaxNumPlatforms])) + 1,
-            envState.rng
-        );
+        numPlatforms = randRange(obstaclesParams.minNumPlatforms, obstaclesParams.maxNumPlatforms + 1, envState.rng);
 
         static const std::vector<int> orientations = {ORIENTATION_STRAIGHT, ORIENTATION_TURN_LEFT, ORIENTATION_TURN_RIGHT};
 
-        auto startPlatformPtr = std::make_unique<StartPlatform>(platformsComponent.levelRoot.get(), envState.rng, floatParams);
+        auto startPlatformPtr = std::make_unique<StartPlatform>(platformsComponent.levelRoot.get(), envState.rng, obstaclesParams);
         startPlatformPtr->init(), startPlatformPtr->generate();
         int requiredWidth = startPlatformPtr->width;
 
@@ -87,7 +87,7 @@ void ObstaclesScenario::reset()
         platformsComponent.addPlatform(std::move(startPlatformPtr));
 
         int numMaxDifficultyObstacles = 0;
-        int numAllowedMaxDifficultyObstacles = int(floatParams.at(Str::obstaclesNumAllowedMaxDifficulty));
+        const int numAllowedMaxDifficultyObstacles = obstaclesParams.numAllowedMaxDifficulty;
 
         for (int i = 0; i < numPlatforms; ++i) {
             auto orientation = randomSample(orientations, envState.rng);
@@ -95,7 +95,7 @@ void ObstaclesScenario::reset()
 
             std::unique_ptr<Platform> newPlatform;
             while (!newPlatform || (newPlatform->isMaxDifficulty() && numMaxDifficultyObstacles >= numAllowedMaxDifficultyObstacles)) {
-                newPlatform = makePlatform(platformTypes, previousPlatform->nextPlatformAnchor, envState.rng, WALLS_WEST | WALLS_EAST, floatParams, requiredWidth);
+                newPlatform = makePlatform(platformTypes, previousPlatform->nextPlatformAnchor, envState.rng, WALLS_WEST | WALLS_EAST, obstaclesParams, requiredWidth);
                 newPlatform->init();
             }
 
@@ -127,7 +127,7 @@ void ObstaclesScenario::reset()
                 walls |= orientation == ORIENTATION_TURN_LEFT ? WALLS_WEST : WALLS_EAST;
                 const int w = previousPlatform->width, l = platform->width - 1;
 
-                platformsComponent.addPlatform(std::make_unique<TransitionPlatform>(previousPlatform->nextPlatformAnchor, envState.rng, walls, floatParams, l, w));
+                platformsComponent.addPlatform(std::make_unique<TransitionPlatform>(previousPlatform->nextPlatformAnchor, envState.rng, walls, obstaclesParams, l, w));
                 auto transitionPlatform = platforms.back().get();
 
                 transitionPlatform->init();
@@ -138,7 +138,7 @@ void ObstaclesScenario::reset()
             requiredWidth = platform->width;
         }
 
-        auto exitPlatformPtr = std::make_unique<ExitPlatform>(previousPlatform->nextPlatformAnchor, envState.rng, floatParams, requiredWidth);
+        auto exitPlatformPtr = std::make_unique<ExitPlatform>(previousPlatform->nextPlatformAnchor, envState.rng, obstaclesParams, requiredWidth);
         exitPlatformPtr->init(), exitPlatformPtr->generate();
         platformsComponent.addPlatform(std::move(exitPlatformPtr));
 
@@ -162,9 +162,14 @@ void ObstaclesScenario::reset()
 
     auto layoutColor = randomLayoutColor(envState.rng);
     auto wallColor = randomLayoutColor(envState.rng);
-    for (auto &p : platforms)
+    for (auto &p : platforms) {
         vg.addPlatform(*p, layoutColor, wallColor, drawWalls);
 
+        for (auto &[terrainType, boxes] : p->terrainBoxes)
+            for (auto &bb : boxes)
+                terrainBoxes.push_back({terrainType, bb.boundingBox()});
+    }
+
     assert(startPlatform);
     agentSpawnPositions = startPlatform->agentSpawnPoints(env.getNumAgents());
     fallDetection.agentInitialPositions = agentSpawnPositions;
@@ -243,10 +248,8 @@ void ObstaclesScenario::addEpisodeDrawables(DrawablesMap &drawables)
     addDrawablesAndCollisionObjectsFromVoxelGrid(vg, drawables, envState, 1);
 
     // add terrains
-    for (auto &platform : platformsComponent.platforms)
-        for (auto &[terrainType, boxes] : platform->terrainBoxes)
-            for (auto &bb : boxes)
-                addTerrain(drawables, envState, terrainType, bb.boundingBox());
+    for (const auto &terrainBox : terrainBoxes)
+        addTerrain(drawables, envState, terrainBox.type, terrainBox.bb);
 
     objectStackingComponent.addDrawablesAndCollisions(drawables, envState, objectSpawnPositions);
 
@@ -271,6 +274,56 @@ void ObstaclesScenario::agentFell(int)
     // otherwise they get discouraged and never even go near these obstacles
 }
 
+void ObstaclesScenario::saveState(SnapshotWriter &writer) const
+{
+    DefaultScenario::saveState(writer);
+
+    vg.saveState(writer);
+    objectStackingComponent.saveState(writer);
+
+    writer.write(agentReachedExit);
+    writer.write(solved);
+}
+
+void ObstaclesScenario::loadState(SnapshotReader &reader)
+{
+    DefaultScenario::loadState(reader);
+
+    vg.loadState(reader);
+    objectStackingComponent.loadState(reader);
+
+    reader.read(agentReachedExit);
+    reader.read(solved);
+}
+
+void ObstaclesScenario::saveLevel(Level &level) const
+{
+    level.clear();
+
+    for (const auto &[coords, voxel] : vg.grid.getHashMap())
+        level.voxels.push_back({coords, voxel.voxelType, voxel.terrain, voxel.color});
+
+    level.terrainBoxes = terrainBoxes;
+    level.agentPositions = agentSpawnPositions;
+    level.objectPositions = objectSpawnPositions;
+    level.rewardPositions = rewardSpawnPositions;
+    level.ints = {numPlatforms};
+}
+
+void ObstaclesScenario::loadLevel(const Level &level)
+{
+    for (const auto &v : level.voxels)
+        vg.grid.set(v.coords, makeVoxel<VoxelObstacles>(v.voxelType, v.terrain, v.color));
+
+    terrainBoxes = level.terrainBoxes;
+    agentSpawnPositions = level.agentPositions;
+    objectSpawnPositions = level.objectPositions;
+    rewardSpawnPositions = level.rewardPositions;
+    numPlatforms = level.ints.empty() ? 0 : level.ints.front();
+
+    fallDetection.agentInitialPositions = agentSpawnPositions;
+}
+
 void ObstaclesScenario::agentTouchedLava(int agentIdx)
 {
     fallDetection.resetAgent(agentIdx, envState.agents[agentIdx]);
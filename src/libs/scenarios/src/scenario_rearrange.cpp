@@ -11,8 +11,8 @@ using namespace Megaverse;
 class RearrangeScenario::RearrangePlatform : public EmptyPlatform
 {
 public:
-    explicit RearrangePlatform(Object3D *parent, Rng &rng, int walls, const FloatParams &params, int)
-    : EmptyPlatform(parent, rng, walls, params)
+    explicit RearrangePlatform(Object3D *parent, Rng &rng, int walls, int)
+    : EmptyPlatform(parent, rng, walls, ObstaclesParams{})
     {
     }
 
@@ -51,7 +51,7 @@ void RearrangeScenario::reset()
     objectStackingComponent.reset(env, envState);
     platformsComponent.reset(env, envState);
 
-    platform = std::make_unique<RearrangePlatform>(platformsComponent.levelRoot.get(), envState.rng, WALLS_ALL, floatParams, env.getNumAgents());
+    platform = std::make_unique<RearrangePlatform>(platformsComponent.levelRoot.get(), envState.rng, WALLS_ALL, env.getNumAgents());
     platform->init(), platform->generate();
     vg.addPlatform(*platform, ColorRgb::DARK_GREY, ColorRgb::DARK_GREY, randomBool(envState.rng));
 
@@ -235,9 +235,7 @@ void RearrangeScenario::arrangementDrawables(DrawablesMap &drawables, const Arra
 
         auto translation = Magnum::Vector3{float(pos.x()) + 0.5f, float(pos.y()) + 0.5f, float(pos.z()) + 0.5f};
 
-        auto bBoxShape = std::make_unique<btBoxShape>(btVector3{1, 1, 1});
-
-        auto &object = envState.scene->addChild<ArrangementObject>(envState.scene.get(), 0.0f, bBoxShape.get(), envState.physics->bWorld);
+        auto &object = envState.addChild<ArrangementObject>(*envState.scene, envState.physics->boxShapes, envState.physics->bWorld);
         object.arrangementItem = item;
 
         object.scale(scales.at(item.shape) * objSize).translate(translation);
@@ -250,8 +248,6 @@ void RearrangeScenario::arrangementDrawables(DrawablesMap &drawables, const Arra
 
         drawables[item.shape].emplace_back(&object, rgb(item.color));
 
-        envState.physics->collisionShapes.emplace_back(std::move(bBoxShape));
-
         if (interactive) {
             VoxelRearrange voxelState;
             voxelState.physicsObject = &object;
@@ -263,12 +263,12 @@ void SokobanScenario::addEpisodeDrawables(DrawablesMap &drawables)
             const auto pos = Magnum::Vector3(voxelSize * float(x) + voxelSize / 2, voxelSize, voxelSize * float(z) + voxelSize / 2);
             const auto h = height.at(SokobanTerrain(v->terrain));
 
-            auto &terrainObject = envState.scene->addChild<Object3D>(envState.scene.get());
+            auto &terrainObject = envState.addChild(*envState.scene);
             terrainObject.scale({1, h, 1});
             terrainObject.translate({0.0, h, 0.0});
             terrainObject.translate(pos);
 
-            drawables[DrawableType::Box].emplace_back(&terrainObject, rgb(colors.at(SokobanTerrain(v->terrain))));
+            drawables[DrawableType::Box].emplace_back(&terrainObject, rgb(colors.at(SokobanTerrain(v->terrain))), true);
         }
     }
 
@@ -276,16 +276,14 @@ void SokobanScenario::addEpisodeDrawables(DrawablesMap &drawables)
         auto scale = Magnum::Vector3{voxelSize / 2, 0.45f, voxelSize / 2} * 0.8f;
         auto translation = Magnum::Vector3{float(box.x()) + 0.5f, float(box.y()) + 0.2f, float(box.z()) + 0.5f} * voxelSize;
 
-        auto &layoutBox = envState.scene->addChild<Object3D>();
+        auto &layoutBox = envState.addChild(*envState.scene);
         layoutBox.scale(scale).translate(translation);
         drawables[DrawableType::Box].emplace_back(&layoutBox, rgb(ColorRgb::DARK_BLUE));
 
-        auto bBoxShape = std::make_unique<btBoxShape>(btVector3{1, 1, 1});
-        auto &collisionBox = layoutBox.addChild<RigidBody>(envState.scene.get(), 0.0f, bBoxShape.get(), envState.physics->bWorld);
+        auto &collisionBox = envState.addChild<RigidBody>(layoutBox, envState.physics->boxShapes, envState.physics->bWorld);
         collisionBox.setCollisionScale({1.15, 3, 1.15});
         collisionBox.setCollisionOffset({0, 0.6, 0});
         collisionBox.syncPose();
-        envState.physics->collisionShapes.emplace_back(std::move(bBoxShape));
 
         if (!g.hasVoxel({box}))
             g.set(box, makeVoxel<VoxelWithPhysicsObjects>(VOXEL_EMPTY));
@@ -8,8 +8,8 @@ using namespace Megaverse;
 class TowerBuildingScenario::TowerBuildingPlatform : public EmptyPlatform
 {
 public:
-    explicit TowerBuildingPlatform(Object3D *parent, Rng &rng, int walls, const FloatParams &params, int numAgents)
-    : EmptyPlatform(parent, rng, walls, params)
+    explicit TowerBuildingPlatform(Object3D *parent, Rng &rng, int walls, int numAgents)
+    : EmptyPlatform(parent, rng, walls, ObstaclesParams{})
     , numAgents{numAgents}
     {
     }
@@ -140,7 +140,7 @@ void TowerBuildingScenario::reset()
     while (layoutColor == ColorRgb::BUILDING_ZONE)
         layoutColor = randomLayoutColor(envState.rng);
 
-    platform = std::make_unique<TowerBuildingPlatform>(platformsComponent.levelRoot.get(), envState.rng, WALLS_ALL, floatParams, env.getNumAgents());
+    platform = std::make_unique<TowerBuildingPlatform>(platformsComponent.levelRoot.get(), envState.rng, WALLS_ALL, env.getNumAgents());
     platform->init(), platform->generate();
     vg.addPlatform(*platform, layoutColor, randomLayoutColor(envState.rng), randomBool(envState.rng));
 
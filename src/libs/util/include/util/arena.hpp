@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+
+namespace Megaverse
+{
+
+/**
+ * Monotonic bump allocator for objects that all die at the same time, e.g. everything created for one episode.
+ * Individual allocations are never freed, reset() releases everything at once. Memory is requested from the heap
+ * in large blocks, and after a reset() the blocks are coalesced into one, so once the arena has seen the largest
+ * episode allocations are just pointer bumps.
+ * Not thread-safe.
+ */
+class Arena
+{
+public:
+    explicit Arena(size_t blockSize = 64 * 1024);
+
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+    Arena & operator=(const Arena &) = delete;
+
+    void * allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    /**
+     * Forget all allocations. Destructors are not called, objects in the arena must be destroyed before this.
+     */
+    void reset();
+
+    /**
+     * Without bump allocation every allocate() is a separate heap allocation (still released in reset()).
+     * Only useful to measure the difference.
+     */
+    void setBumpAllocation(bool enable);
+
+    size_t bytesAllocated() const { return allocatedBytes; }
+
+    size_t capacity() const;
+
+private:
+    struct Block
+    {
+        std::unique_ptr<char[]> memory;
+        size_t size;
+    };
+
+    void addBlock(size_t minSize);
+
+private:
+    size_t blockSize;
+    bool bumpAllocation = true;
+
+    std::vector<Block> blocks;
+    char *ptr = nullptr, *end = nullptr;
+
+    size_t allocatedBytes = 0;
+};
+
+
+/**
+ * A scene graph node (or anything else deleted through a virtual destructor) with its memory in an Arena:
+ *
+ *     auto node = new (arena) ArenaAllocated<Object3D>{parent};
+ *
+ * Parents delete their children with a plain delete, which for these objects only runs the destructor.
+ * The memory goes away with Arena::reset(). A plain new does not compile.
+ */
+template<typename Base>
+class ArenaAllocated : public Base
+{
+public:
+    using Base::Base;
+
+    static void * operator new(size_t size, Arena &arena) { return arena.allocate(size, alignof(ArenaAllocated)); }
+
+    // called if the constructor throws
+    static void operator delete(void *, Arena &) {}
+
+    static void operator delete(void *) {}
+};
+
+}
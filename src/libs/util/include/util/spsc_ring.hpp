@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+
+namespace Megaverse
+{
+
+/**
+ * Bounded lock-free queue for exactly one producer thread and one consumer thread.
+ * Head and tail live on separate cache lines, so the producer and the consumer only share the lines when the queue
+ * actually transfers an element.
+ * @tparam Capacity must be a power of two.
+ */
+template<typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    /**
+     * Producer side.
+     * @return false if the ring is full.
+     */
+    bool push(const T &value)
+    {
+        const auto t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity)
+            return false;
+
+        items[t & (Capacity - 1)] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Consumer side.
+     * @return false if the ring is empty.
+     */
+    bool pop(T &value)
+    {
+        const auto h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+
+        value = items[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Can be called from either side, the result can be outdated by the time it is used.
+     */
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(64) std::atomic<size_t> head = 0;
+    alignas(64) std::atomic<size_t> tail = 0;
+    alignas(64) std::array<T, Capacity> items{};
+};
+
+}
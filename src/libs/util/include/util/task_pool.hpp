@@ -0,0 +1,60 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <future>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+
+namespace Megaverse
+{
+
+/**
+ * Fixed number of threads executing tasks from a shared FIFO queue. Meant for occasional heavy background work
+ * (e.g. generating the next episode of an env), not for the per-step simulation, which has its own threads in
+ * VectorEnv.
+ */
+class TaskPool
+{
+public:
+    /**
+     * @param lowPriority lower the scheduling priority of the threads (Linux only), so the background work yields to
+     * the simulation threads when the cores are oversubscribed.
+     */
+    explicit TaskPool(int numThreads, bool lowPriority = false);
+
+    /**
+     * Waits for the running tasks to finish, tasks still in the queue are discarded (their futures throw
+     * std::future_error).
+     */
+    ~TaskPool();
+
+    TaskPool(const TaskPool &) = delete;
+    TaskPool & operator=(const TaskPool &) = delete;
+
+    std::future<void> submit(std::function<void()> task);
+
+    int numThreads() const { return int(threads.size()); }
+
+    /**
+     * Process-wide low-priority pool with a handful of threads (a quarter of the cores, at most 4).
+     * Never destroyed, so objects destroyed during static destruction can still wait for their tasks.
+     */
+    static TaskPool & background();
+
+private:
+    void loop(bool lowPriority);
+
+private:
+    std::mutex mutex;
+    std::condition_variable tasksAvailable;
+    std::deque<std::packaged_task<void()>> tasks;
+    bool stop = false;
+
+    std::vector<std::thread> threads;
+};
+
+}
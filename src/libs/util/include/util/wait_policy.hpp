@@ -0,0 +1,116 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <condition_variable>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+#include <util/macro.hpp>
+
+
+namespace Megaverse
+{
+
+/**
+ * Hint to the CPU that we're in a spin-wait loop (reduces power consumption and the penalty on loop exit).
+ */
+FORCE_INLINE void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+/**
+ * How threads wait for each other.
+ * Spin: busy-wait, lowest latency, but burns a whole core while waiting.
+ * Sleep: block on a condition variable (futex on Linux) right away, frees the core but adds wake-up latency.
+ * Hybrid: spin for spinIterations, then go to sleep. Short waits are as fast as with spinning, long waits don't
+ * steal the CPU from other processes (e.g. the learner).
+ */
+struct WaitPolicy
+{
+    enum class Type
+    {
+        Spin,
+        Sleep,
+        Hybrid,
+    };
+
+    Type type = Type::Hybrid;
+    int spinIterations = 5000;
+};
+
+/**
+ * @param name one of "spin", "sleep", "hybrid" (case-insensitive)
+ * @param ok set to false if the name is not recognized, in which case the default policy is returned
+ */
+WaitPolicy::Type waitPolicyFromString(const std::string &name, bool &ok);
+
+std::string waitPolicyToString(WaitPolicy::Type type);
+
+
+/**
+ * Lets threads wait until a predicate (over atomics modified by other threads) becomes true, according to the
+ * wait policy. Whoever changes the state the predicate depends on must call notifyAll() afterwards.
+ * The mutex is only touched if some thread actually went to sleep, so with spinning waiters notifyAll() is a single
+ * atomic load.
+ */
+class SpinSleepEvent
+{
+public:
+    explicit SpinSleepEvent(WaitPolicy policy = WaitPolicy{})
+    : policy{policy}
+    {
+    }
+
+    template<typename Predicate>
+    void wait(Predicate predicate)
+    {
+        if (policy.type != WaitPolicy::Type::Sleep) {
+            for (int i = 0; policy.type == WaitPolicy::Type::Spin || i < policy.spinIterations; ++i) {
+                if (predicate())
+                    return;
+
+                cpuRelax();
+            }
+        }
+
+        std::unique_lock<std::mutex> lock{mutex};
+
+        // the increment has to be visible before we check the predicate for the last time, otherwise the notifying
+        // thread can miss us. The fences pair with the one in notifyAll(), so this also holds when the state behind
+        // the predicate is published with a release store rather than a sequentially consistent one.
+        ++numSleepers;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cvWakeup.wait(lock, predicate);
+        --numSleepers;
+    }
+
+    void notifyAll()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (numSleepers.load() > 0) {
+            std::lock_guard<std::mutex> lock{mutex};
+            cvWakeup.notify_all();
+        }
+    }
+
+    const WaitPolicy & getPolicy() const { return policy; }
+
+private:
+    WaitPolicy policy;
+
+    std::atomic<int> numSleepers = 0;
+    std::mutex mutex;
+    std::condition_variable cvWakeup;
+};
+
+}
@@ -0,0 +1,91 @@
+#include <cstdint>
+#include <algorithm>
+
+#include <util/arena.hpp>
+#include <util/tiny_logger.hpp>
+
+
+namespace Megaverse
+{
+
+Arena::Arena(size_t blockSize)
+: blockSize{blockSize}
+{
+}
+
+Arena::~Arena() = default;
+
+void * Arena::allocate(size_t size, size_t alignment)
+{
+    TCHECK(alignment > 0 && (alignment & (alignment - 1)) == 0) << "Alignment must be a power of two";
+
+    if (!bumpAllocation) {
+        // uninitialized memory, like malloc()
+        blocks.push_back({std::unique_ptr<char[]>{new char[size + alignment]}, size + alignment});
+        ptr = blocks.back().memory.get(), end = ptr + blocks.back().size;
+    }
+
+    auto aligned = (uintptr_t(ptr) + alignment - 1) & ~uintptr_t(alignment - 1);
+
+    if (!ptr || aligned + size > uintptr_t(end)) {
+        addBlock(size + alignment);
+        aligned = (uintptr_t(ptr) + alignment - 1) & ~uintptr_t(alignment - 1);
+    }
+
+    ptr = reinterpret_cast<char *>(aligned + size);
+    allocatedBytes += size;
+
+    return reinterpret_cast<void *>(aligned);
+}
+
+void Arena::reset()
+{
+    if (bumpAllocation && blocks.size() > 1) {
+        // the next episode is probably about the same size, make sure it fits in a single block
+        size_t totalSize = 0;
+        for (const auto &block : blocks)
+            totalSize += block.size;
+
+        blocks.clear();
+        addBlock(totalSize);
+    } else if (!bumpAllocation) {
+        blocks.clear();
+    }
+
+    if (blocks.empty())
+        ptr = end = nullptr;
+    else
+        ptr = blocks.front().memory.get(), end = ptr + blocks.front().size;
+
+    allocatedBytes = 0;
+}
+
+void Arena::setBumpAllocation(bool enable)
+{
+    if (enable == bumpAllocation)
+        return;
+
+    TCHECK(allocatedBytes == 0) << "Arena allocation mode can only be changed after a reset()";
+
+    bumpAllocation = enable;
+    blocks.clear();
+    ptr = end = nullptr;
+}
+
+size_t Arena::capacity() const
+{
+    size_t totalSize = 0;
+    for (const auto &block : blocks)
+        totalSize += block.size;
+
+    return totalSize;
+}
+
+void Arena::addBlock(size_t minSize)
+{
+    const auto size = std::max(minSize, blockSize);
+    blocks.push_back({std::unique_ptr<char[]>{new char[size]}, size});
+    ptr = blocks.back().memory.get(), end = ptr + size;
+}
+
+}
@@ -0,0 +1,82 @@
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+#include <util/macro.hpp>
+#include <util/task_pool.hpp>
+
+
+namespace Megaverse
+{
+
+TaskPool::TaskPool(int numThreads, bool lowPriority)
+{
+    for (int i = 0; i < std::max(1, numThreads); ++i)
+        threads.emplace_back([this, lowPriority] { loop(lowPriority); });
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stop = true;
+    }
+
+    tasksAvailable.notify_all();
+
+    for (auto &t : threads)
+        t.join();
+}
+
+std::future<void> TaskPool::submit(std::function<void()> task)
+{
+    std::packaged_task<void()> packagedTask{std::move(task)};
+    auto future = packagedTask.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        tasks.emplace_back(std::move(packagedTask));
+    }
+
+    tasksAvailable.notify_one();
+    return future;
+}
+
+TaskPool & TaskPool::background()
+{
+    static auto pool = new TaskPool{std::clamp(int(std::thread::hardware_concurrency()) / 4, 1, 4), true};
+    return *pool;
+}
+
+void TaskPool::loop(bool lowPriority)
+{
+#ifdef __linux__
+    // on Linux the nice value is per thread
+    if (lowPriority)
+        setpriority(PRIO_PROCESS, 0, 10);
+#else
+    UNUSED(lowPriority);
+#endif
+
+    while (true) {
+        std::packaged_task<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            tasksAvailable.wait(lock, [this] { return stop || !tasks.empty(); });
+
+            if (stop)
+                return;
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        // exceptions end up in the future
+        task();
+    }
+}
+
+}
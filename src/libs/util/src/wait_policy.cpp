@@ -0,0 +1,37 @@
+#include <util/wait_policy.hpp>
+#include <util/string_utils.hpp>
+
+
+namespace Megaverse
+{
+
+WaitPolicy::Type waitPolicyFromString(const std::string &name, bool &ok)
+{
+    ok = true;
+
+    const auto lowercase = toLower(name);
+    if (lowercase == "spin")
+        return WaitPolicy::Type::Spin;
+    else if (lowercase == "sleep")
+        return WaitPolicy::Type::Sleep;
+    else if (lowercase == "hybrid")
+        return WaitPolicy::Type::Hybrid;
+
+    ok = false;
+    return WaitPolicy{}.type;
+}
+
+std::string waitPolicyToString(WaitPolicy::Type type)
+{
+    switch (type) {
+        case WaitPolicy::Type::Spin:
+            return "spin";
+        case WaitPolicy::Type::Sleep:
+            return "sleep";
+        case WaitPolicy::Type::Hybrid:
+        default:
+            return "hybrid";
+    }
+}
+
+}
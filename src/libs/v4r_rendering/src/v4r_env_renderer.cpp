@@ -114,7 +114,10 @@ public:
 
     glm::u32vec2 framebufferSize;
 
-    int pixelsPerFrame{}, pixelsPerEnv{};
+    int pixelsPerFrame{};
+
+    // index of the first agent of every env in the batch, envs can have different numbers of agents
+    std::vector<int> firstRenderEnvIdx;
 
 //    vector<uint8_t> cpuFrames;
 
@@ -200,17 +203,22 @@ V4REnvRenderer::Impl::Impl(Envs &envs, int w, int h, V4REnvRenderer *previousRen
 
     // Materials
     {
-        const auto palette = envs.front()->getPalette();
         constexpr float shininess = 300.0f;
 
-        for (auto c : palette) {
-            materialIndices[c] = int(materials.size());
+        // envs can run different scenarios, so we need the union of all palettes
+        for (const auto &env : envs) {
+            for (auto c : env->getPalette()) {
+                if (materialIndices.count(c))
+                    continue;
+
+                materialIndices[c] = int(materials.size());
 
-            materials.emplace_back(loader.makeMaterial(MaterialParams {
-                glm::vec3(c.r(), c.g(), c.b()),
-                glm::vec3(1.f),
-                shininess
-            }));
+                materials.emplace_back(loader.makeMaterial(MaterialParams {
+                    glm::vec3(c.r(), c.g(), c.b()),
+                    glm::vec3(1.f),
+                    shininess
+                }));
+            }
         }
     }
 
@@ -227,13 +235,15 @@ V4REnvRenderer::Impl::Impl(Envs &envs, int w, int h, V4REnvRenderer *previousRen
         auto [fov, near, far, aspectRatio] = agentCameraParameters();
         UNUSED(aspectRatio);
 
-        for (auto &env : envs)
+        for (auto &env : envs) {
+            firstRenderEnvIdx.emplace_back(int(renderEnvs.size()));
+
             for (int agentIdx = 0; agentIdx < env->getNumAgents(); ++agentIdx)
                 renderEnvs.emplace_back(cmdStream.makeEnvironment(scene, fov, near, far));
+        }
     }
 
     pixelsPerFrame = framebufferSize.x * framebufferSize.y * 4;
-    pixelsPerEnv = envs.front()->getNumAgents() * pixelsPerFrame;
 }
 
 V4REnvRenderer::Impl::~Impl()
@@ -251,21 +261,27 @@ void V4REnvRenderer::Impl::reset(Env &env, int envIdx)
     UNUSED(aspectRatio);
 
     for (int i = 0; i < env.getNumAgents(); ++i) {
-        const auto idx = envIdx * env.getNumAgents() + i;  // assuming all envs have the same numAgents
+        const auto idx = firstRenderEnvIdx[envIdx] + i;
         renderEnvs[idx] = cmdStream.makeEnvironment(scene, fov, near, far);
     }
 
     // reset renderer data structures
     {
-        envDrawables[envIdx] = SceneGraph::DrawableGroup3D{};
+        // detach the features of the previous episode instead of just replacing the group: with episode
+        // pregeneration the old scene is destroyed later on another thread, and the features must not touch this
+        // group when that happens
+        auto &group = envDrawables[envIdx];
+        while (!group.isEmpty())
+            group.remove(group[group.size() - 1]);
     }
 
     // drawables
     {
         const auto &drawables = env.getDrawables();
+        const auto &staticDrawables = env.getStaticDrawables();
 
         for (int agentIdx = 0; agentIdx < env.getNumAgents(); ++agentIdx) {
-            const auto renderEnvIdx = envIdx * env.getNumAgents() + agentIdx;
+            const auto renderEnvIdx = firstRenderEnvIdx[envIdx] + agentIdx;
             auto &renderEnv = renderEnvs[renderEnvIdx];
 
             for (const auto &[drawableType, meshIndex] : meshIndices) {
@@ -275,6 +291,12 @@ void V4REnvRenderer::Impl::reset(Env &env, int envIdx)
                     const auto renderID = renderEnv.addInstance(uint32_t(meshIndex), uint32_t(materialIdx), glm::mat4(1.f));
                     sceneObjectInfo.objectPtr->addFeature<V4RDrawable>(renderEnv, renderID, envDrawables[envIdx]);
                 }
+
+                // static drawables get their final transformation right away and are never updated
+                for (const auto &staticDrawable : staticDrawables.at(drawableType)) {
+                    const auto materialIdx = materialIndices[staticDrawable.color];
+                    renderEnv.addInstance(uint32_t(meshIndex), uint32_t(materialIdx), glm::make_mat4(staticDrawable.transformationMatrix.data()));
+                }
             }
         }
 
@@ -302,7 +324,7 @@ void V4REnvRenderer::Impl::preDraw(Env &env, int envIdx)
 
     const auto numAgents = env.getNumAgents();
     for (int agentIdx = 0; agentIdx < numAgents; ++agentIdx) {
-        const auto renderEnvIdx = envIdx * numAgents + agentIdx;
+        const auto renderEnvIdx = firstRenderEnvIdx[envIdx] + agentIdx;
         v4r::Environment &renderEnv = renderEnvs[renderEnvIdx];
 
         auto activeCameraPtr = env.getAgents()[agentIdx]->getCamera();
@@ -356,8 +378,8 @@ void V4REnvRenderer::Impl::draw(Envs &)
 
 const uint8_t * V4REnvRenderer::Impl::getObservation(int envIdx, int agentIdx) const
 {
-    const auto startIdx = envIdx * pixelsPerEnv;
-    return cmdStream.getRGB() + startIdx + agentIdx * pixelsPerFrame;
+    const auto renderEnvIdx = firstRenderEnvIdx[envIdx] + agentIdx;
+    return cmdStream.getRGB() + size_t(renderEnvIdx) * size_t(pixelsPerFrame);
 //    return cpuFrames.data() + agentIdx * framebufferSize.x * framebufferSize.y * 4;
 }
 
@@ -0,0 +1,361 @@
+#include <cmath>
+#include <random>
+#include <memory>
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include <BulletCollision/CollisionDispatch/btGhostObject.h>
+#include <BulletCollision/CollisionShapes/btCapsuleShape.h>
+
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/SceneGraph/Scene.h>
+
+#include <env/agent_controls.hpp>
+#include <env/kinematic_character_controller.hpp>
+
+
+using namespace Magnum;
+
+using namespace Megaverse;
+
+
+namespace
+{
+
+using Controller = KinematicCharacterController;
+
+constexpr float dt = 1.0f / 15.0f, pitchLimit = 1.2f;
+const Vector3 cameraOffset{0.0f, 0.41f, 0.0f};
+
+/**
+ * The per-agent rule applyActions() replaced: Env::step() choosing the directions, DefaultKinematicAgent rotating the
+ * ghost object and the camera, KinematicCharacterController::setAcceleration() integrating the velocity.
+ */
+struct ReferenceAgent
+{
+    btMatrix3x3 basis = btMatrix3x3::getIdentity();
+    float pitch = 0;
+    btVector3 velocity{0, 0, 0};
+    bool onGround = true, jumped = false;
+
+    void apply(Action a)
+    {
+        const auto has = [a](Action action) { return !!(a & action); };
+
+        auto forward = basis[2];
+        forward.setZ(-forward.z());
+        forward.normalize();
+
+        auto strafeLeft = basis[0];
+        strafeLeft.setX(-strafeLeft.x());
+        strafeLeft.normalize();
+
+        btVector3 acc{0, 0, 0};
+
+        if (has(Action::Forward))
+            acc += forward;
+        else if (has(Action::Backward))
+            acc -= forward;
+
+        if (has(Action::Left))
+            acc += strafeLeft;
+        else if (has(Action::Right))
+            acc -= strafeLeft;
+
+        if (has(Action::LookLeft))
+            basis *= btMatrix3x3{btQuaternion{btVector3{0, 1, 0}, AgentControls::rotateRadians * dt}};
+        else if (has(Action::LookRight))
+            basis *= btMatrix3x3{btQuaternion{btVector3{0, 1, 0}, -AgentControls::rotateRadians * dt}};
+
+        if (has(Action::LookUp))
+            pitch = std::min(pitchLimit, pitch + AgentControls::rotateXRadians * dt);
+        else if (has(Action::LookDown))
+            pitch = std::max(-pitchLimit, pitch - AgentControls::rotateXRadians * dt * 1.1f);
+
+        if (!acc.fuzzyZero())
+            acc *= (onGround ? Controller::maxAcceleration : Controller::maxAirAcceleration) / acc.length();
+
+        if (onGround) {
+            velocity += acc * dt;
+
+            const auto speed = velocity.length();
+            if (speed > Controller::maxHorizontalSpeed) {
+                const auto dv = Controller::exceedingSpeedLimitDeceleration * dt;
+                velocity *= (speed - dv > Controller::maxHorizontalSpeed ? speed - dv : Controller::maxHorizontalSpeed) / speed;
+            }
+        } else {
+            const auto newVelocity = velocity + acc * dt;
+            if (newVelocity.length() <= Controller::maxAirSpeed || newVelocity.length() < velocity.length())
+                velocity = newVelocity;
+        }
+
+        jumped = has(Action::Jump) && onGround;
+    }
+};
+
+}
+
+
+class AgentControlsTest : public ::testing::Test {
+protected:
+    struct TestAgent
+    {
+        btCapsuleShape shape{0.33f, 1.05f};
+        btPairCachingGhostObject ghost;
+        std::unique_ptr<Controller> controller;
+        Object3D *camera = nullptr;
+    };
+
+    void addAgents(int numAgents)
+    {
+        for (int i = 0; i < numAgents; ++i) {
+            auto &agent = *agents.emplace_back(std::make_unique<TestAgent>());
+            agent.ghost.setCollisionShape(&agent.shape);
+            agent.controller = std::make_unique<Controller>(&agent.ghost, &agent.shape, 0.2f, btVector3{0, 1, 0});
+            agent.camera = &scene.addChild<Object3D>();
+
+            controls.add(&agent.ghost, agent.controller.get(), agent.camera, cameraOffset, 0.0f, pitchLimit);
+        }
+    }
+
+    void step(std::vector<Action> actions) { controls.applyActions(actions.data(), dt); }
+
+    float speed(int i) const { return std::hypot(controls.velocityX[i], controls.velocityZ[i]); }
+
+    void expectMatches(int i, const ReferenceAgent &ref)
+    {
+        const auto &basis = agents[i]->ghost.getWorldTransform().getBasis();
+        for (int row = 0; row < 3; ++row)
+            for (int col = 0; col < 3; ++col)
+                ASSERT_NEAR(basis[row][col], ref.basis[row][col], 5e-4f) << "agent " << i << " basis " << row << col;
+
+        ASSERT_NEAR(controls.pitch[i], ref.pitch, 1e-5f) << "agent " << i;
+
+        const auto expectedCamera = Matrix4::translation(cameraOffset) * Matrix4::rotationX(Rad{ref.pitch});
+        const auto camera = agents[i]->camera->transformationMatrix();
+        for (int col = 0; col < 4; ++col)
+            for (int row = 0; row < 4; ++row)
+                ASSERT_NEAR(camera[col][row], expectedCamera[col][row], 1e-5f) << "agent " << i;
+
+        ASSERT_NEAR(controls.velocityX[i], ref.velocity.x(), 1e-3f) << "agent " << i;
+        ASSERT_NEAR(controls.velocityZ[i], ref.velocity.z(), 1e-3f) << "agent " << i;
+
+        // the velocity is written to the controller for the physics step
+        const auto &velocity = agents[i]->controller->getHorizontalVelocity();
+        ASSERT_EQ(velocity.x(), controls.velocityX[i]);
+        ASSERT_EQ(velocity.z(), controls.velocityZ[i]);
+    }
+
+    Scene3D scene;
+    std::vector<std::unique_ptr<TestAgent>> agents;
+    AgentControls controls;
+};
+
+
+TEST_F(AgentControlsTest, matchesPerAgentRule)
+{
+    constexpr int numAgents = 8, numFrames = 300;
+    addAgents(numAgents);
+
+    std::vector<ReferenceAgent> refs(numAgents);
+    std::mt19937 rng{17};
+
+    for (int frame = 0; frame < numFrames; ++frame) {
+        std::vector<Action> actions;
+
+        for (int i = 0; i < numAgents; ++i) {
+            // any combination of bits, including both actions of a pair, without the jump that would leave the ground
+            actions.push_back(Action(rng() & 0x7fe & ~int(Action::Jump)));
+
+            // contact is normally updated by the physics step, here it changes at random
+            const bool grounded = rng() % 4 != 0;
+            controls.onGround[i] = grounded;
+            refs[i].onGround = grounded;
+
+            // once in a while something else (an impulse, a teleport) changes the velocity
+            if (rng() % 50 == 0) {
+                const float vx = float(rng() % 1000) / 100 - 5, vz = float(rng() % 1000) / 100 - 5;
+                controls.velocityX[i] = vx, controls.velocityZ[i] = vz;
+                refs[i].velocity = btVector3{vx, 0, vz};
+            }
+        }
+
+        step(actions);
+
+        for (int i = 0; i < numAgents; ++i) {
+            refs[i].apply(actions[i]);
+            expectMatches(i, refs[i]);
+        }
+    }
+}
+
+TEST_F(AgentControlsTest, precedence)
+{
+    addAgents(2);
+
+    // if both actions of a pair are set the first one wins
+    const std::pair<Action, Action> pairs[] = {
+        {Action::Forward, Action::Backward}, {Action::Left, Action::Right},
+        {Action::LookLeft, Action::LookRight}, {Action::LookUp, Action::LookDown},
+    };
+
+    for (const auto &[first, second] : pairs) {
+        for (int i = 0; i < 2; ++i) {
+            controls.teleport(i, btVector3{0, 0, 0});
+            controls.setYaw(i, 0.5f), controls.setPitch(i, 0.0f);
+        }
+
+        step({first | second, first});
+
+        EXPECT_FLOAT_EQ(controls.yaw[0], controls.yaw[1]);
+        EXPECT_FLOAT_EQ(controls.pitch[0], controls.pitch[1]);
+        EXPECT_FLOAT_EQ(controls.velocityX[0], controls.velocityX[1]);
+        EXPECT_FLOAT_EQ(controls.velocityZ[0], controls.velocityZ[1]);
+    }
+}
+
+TEST_F(AgentControlsTest, lookClamping)
+{
+    addAgents(2);
+
+    // looking down is 1.1x faster than looking up
+    step({Action::LookUp, Action::LookDown});
+    EXPECT_FLOAT_EQ(controls.pitch[0], AgentControls::rotateXRadians * dt);
+    EXPECT_FLOAT_EQ(controls.pitch[1], -AgentControls::rotateXRadians * dt * 1.1f);
+
+    for (int frame = 0; frame < 100; ++frame)
+        step({Action::LookUp, Action::LookDown});
+
+    EXPECT_FLOAT_EQ(controls.pitch[0], pitchLimit);
+    EXPECT_FLOAT_EQ(controls.pitch[1], -pitchLimit);
+
+    // yaw is not clamped
+    for (int frame = 0; frame < 100; ++frame)
+        step({Action::LookLeft, Action::LookRight});
+
+    EXPECT_NEAR(controls.yaw[0], 100 * AgentControls::rotateRadians * dt, 1e-3f);
+    EXPECT_NEAR(controls.yaw[1], -100 * AgentControls::rotateRadians * dt, 1e-3f);
+
+    controls.setPitch(0, 10.0f);
+    EXPECT_FLOAT_EQ(controls.pitch[0], pitchLimit);
+}
+
+TEST_F(AgentControlsTest, groundSpeed)
+{
+    addAgents(2);
+
+    // accelerating on the ground saturates at the max walking speed
+    for (int frame = 0; frame < 30; ++frame) {
+        step({Action::Forward, Action::Idle});
+        EXPECT_LE(speed(0), Controller::maxHorizontalSpeed + 1e-4f);
+    }
+    EXPECT_NEAR(speed(0), Controller::maxHorizontalSpeed, 1e-4f);
+
+    // facing -Z with yaw 0
+    EXPECT_NEAR(controls.velocityX[0], 0.0f, 1e-5f);
+    EXPECT_LT(controls.velocityZ[0], 0.0f);
+
+    // above the limit we decelerate by a fixed amount per frame, but never below the limit
+    controls.velocityX[1] = 20.0f;
+    const float dv = Controller::exceedingSpeedLimitDeceleration * dt;
+
+    float prevSpeed = speed(1);
+    while (prevSpeed > Controller::maxHorizontalSpeed) {
+        step({Action::Forward, Action::Idle});
+        EXPECT_FLOAT_EQ(speed(1), std::max(prevSpeed - dv, Controller::maxHorizontalSpeed));
+        prevSpeed = speed(1);
+    }
+
+    // friction is up to the physics step, without actions the speed stays at the limit
+    for (int frame = 0; frame < 5; ++frame)
+        step({Action::Forward, Action::Idle});
+    EXPECT_FLOAT_EQ(speed(1), Controller::maxHorizontalSpeed);
+}
+
+TEST_F(AgentControlsTest, airSpeed)
+{
+    addAgents(2);
+    controls.onGround[0] = controls.onGround[1] = 0;
+
+    // in the air the agents accelerate slowly, up to the max air speed
+    step({Action::Forward, Action::Idle});
+    EXPECT_FLOAT_EQ(speed(0), Controller::maxAirAcceleration * dt);
+    EXPECT_FLOAT_EQ(speed(1), 0.0f);
+
+    for (int frame = 0; frame < 100; ++frame)
+        step({Action::Forward, Action::Idle});
+    EXPECT_LE(speed(0), Controller::maxAirSpeed);
+    EXPECT_GT(speed(0), Controller::maxAirSpeed - Controller::maxAirAcceleration * dt);
+
+    // faster than that (e.g. after a jump from a run) the velocity is kept, no friction or deceleration
+    controls.velocityX[1] = 0.0f, controls.velocityZ[1] = -3.0f;
+    step({Action::Forward, Action::Forward});
+    EXPECT_FLOAT_EQ(controls.velocityZ[1], -3.0f);
+
+    step({Action::Forward, Action::Idle});
+    EXPECT_FLOAT_EQ(controls.velocityZ[1], -3.0f);
+
+    // slowing down is still possible
+    step({Action::Forward, Action::Backward});
+    EXPECT_FLOAT_EQ(controls.velocityZ[1], -3.0f + Controller::maxAirAcceleration * dt);
+}
+
+TEST_F(AgentControlsTest, jumpOnlyWhenGrounded)
+{
+    addAgents(2);
+    controls.onGround[1] = 0;
+
+    ASSERT_TRUE(agents[0]->controller->onGround());
+    ASSERT_TRUE(agents[1]->controller->onGround());
+
+    step({Action::Jump | Action::Forward, Action::Jump | Action::Forward});
+
+    // the controller is in the air right after the jump
+    EXPECT_FALSE(agents[0]->controller->onGround());
+    EXPECT_TRUE(agents[1]->controller->onGround());
+}
+
+TEST_F(AgentControlsTest, syncYaw)
+{
+    addAgents(3);
+
+    // teleport() resets the orientation and the velocity
+    controls.setYaw(0, 1.0f);
+    controls.velocityX[0] = 2.0f;
+    controls.teleport(0, btVector3{1, 2, 3});
+
+    // restore() writes the transforms and velocities directly, the controls have to pick them up
+    const float yaws[] = {0.0f, 2.5f, -3.0f};
+    for (int i = 1; i < 3; ++i) {
+        auto &transform = agents[i]->ghost.getWorldTransform();
+        transform.setBasis(btMatrix3x3{btQuaternion{btVector3{0, 1, 0}, yaws[i]}});
+        agents[i]->controller->setHorizontalVelocity(btVector3{float(i), 0, -1});
+        controls.yaw[i] = 42.0f, controls.velocityX[i] = controls.velocityZ[i] = 0.0f;
+    }
+
+    controls.sync();
+
+    for (int i = 0; i < 3; ++i)
+        EXPECT_NEAR(controls.yaw[i], yaws[i], 1e-5f) << "agent " << i;
+
+    EXPECT_FLOAT_EQ(controls.velocityX[0], 0.0f);
+    EXPECT_FLOAT_EQ(controls.velocityX[2], 2.0f);
+    EXPECT_FLOAT_EQ(controls.velocityZ[2], -1.0f);
+
+    // agents move in the direction of the recovered yaw
+    std::vector<ReferenceAgent> refs(3);
+    for (int i = 0; i < 3; ++i) {
+        refs[i].basis = agents[i]->ghost.getWorldTransform().getBasis();
+        refs[i].velocity = btVector3{controls.velocityX[i], 0, controls.velocityZ[i]};
+        refs[i].onGround = controls.onGround[i];
+    }
+
+    const std::vector<Action> actions{Action::Forward | Action::LookLeft, Action::Left, Action::Backward | Action::Right};
+    step(actions);
+
+    for (int i = 0; i < 3; ++i) {
+        refs[i].apply(actions[i]);
+        expectMatches(i, refs[i]);
+    }
+}
@@ -0,0 +1,64 @@
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include <util/arena.hpp>
+
+
+using namespace Megaverse;
+
+
+namespace
+{
+
+struct Node
+{
+    explicit Node(int &numDestroyed) : numDestroyed{numDestroyed} {}
+    virtual ~Node() { ++numDestroyed; }
+
+    int &numDestroyed;
+    alignas(16) float data[4]{};
+};
+
+}
+
+
+TEST(Arena, alignmentAndCoalescing)
+{
+    Arena arena{128};
+
+    for (int episode = 0; episode < 3; ++episode) {
+        for (size_t alignment : {1, 4, 8, 16, 64}) {
+            const auto ptr = arena.allocate(24, alignment);
+            EXPECT_EQ(uintptr_t(ptr) % alignment, uintptr_t(0));
+        }
+
+        // much larger than a block
+        EXPECT_NE(arena.allocate(1000), nullptr);
+        arena.reset();
+
+        // everything fits into the single coalesced block from now on
+        EXPECT_EQ(arena.bytesAllocated(), size_t(0));
+        EXPECT_GE(arena.capacity(), size_t(5 * 24 + 1000));
+    }
+}
+
+TEST(Arena, deleteOnlyDestroys)
+{
+    Arena arena;
+    int numDestroyed = 0;
+
+    for (bool bumpAllocation : {true, false}) {
+        arena.setBumpAllocation(bumpAllocation);
+
+        for (int i = 0; i < 10; ++i) {
+            Node *node = new (arena) ArenaAllocated<Node>{numDestroyed};
+            EXPECT_EQ(uintptr_t(node) % alignof(Node), uintptr_t(0));
+            delete node;
+        }
+
+        arena.reset();
+    }
+
+    EXPECT_EQ(numDestroyed, 20);
+}
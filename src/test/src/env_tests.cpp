@@ -1,9 +1,16 @@
+#include <set>
+#include <random>
+#include <cstring>
+
 #include <gtest/gtest.h>
 
 #include <Magnum/GL/Context.h>
 
 #include <env/env.hpp>
+#include <env/scenario.hpp>
+#include <env/vector_env.hpp>
 #include <scenarios/init.hpp>
+#include <scenarios/const.hpp>
 
 #include <magnum_rendering/magnum_env_renderer.hpp>
 
@@ -22,6 +29,27 @@ TEST_F(EnvTest, env)
     Env env{"TowerBuilding"};
 }
 
+TEST_F(EnvTest, appParams)
+{
+    // the parameters megaverse_test_app and viewer_app construct their envs with
+    const FloatParams testAppParams, viewerParams{{Str::useUIRewardIndicators, 1.0f}};
+
+    for (const auto &scenario : Scenario::registeredScenarios()) {
+        // needs the Boxoban levels dataset
+        if (scenario == "sokoban")
+            continue;
+
+        for (const auto &params : {testAppParams, viewerParams}) {
+            Env env{scenario, 2, params};
+            env.seed(42);
+            env.reset();
+
+            for (int step = 0; step < 10 && !env.isDone(); ++step)
+                env.step();
+        }
+    }
+}
+
 TEST_F(EnvTest, multipleEnvs)
 {
     Envs envs;
@@ -39,3 +67,720 @@ TEST_F(EnvTest, multipleEnvs)
     for (int i = 0; i < 3; ++i)
         renderer.draw(envs);
 }
+
+TEST_F(EnvTest, atlasRendering)
+{
+    constexpr int numEnvs = 3, numAgents = 2, w = 128, h = 72;
+
+    Envs envs;
+    for (int i = 0; i < numEnvs; ++i) {
+        envs.emplace_back(std::make_unique<Env>("TowerBuilding", numAgents));
+        envs.back()->reset();
+    }
+
+    MagnumEnvRenderer renderer{envs, w, h}, atlasRenderer{envs, w, h};
+    ASSERT_TRUE(atlasRenderer.enableAtlas());
+
+    for (auto r : {&renderer, &atlasRenderer}) {
+        for (int i = 0; i < numEnvs; ++i)
+            r->reset(*envs[i], i);
+
+        r->draw(envs);
+    }
+
+    // same images, and the observations are one contiguous block
+    for (int i = 0; i < numEnvs; ++i)
+        for (int j = 0; j < numAgents; ++j) {
+            EXPECT_EQ(0, memcmp(renderer.getObservation(i, j), atlasRenderer.getObservation(i, j), w * h * 4));
+            EXPECT_EQ(atlasRenderer.getObservation(i, j), atlasRenderer.getObservation(0, 0) + (i * numAgents + j) * w * h * 4);
+        }
+}
+
+TEST_F(EnvTest, pboReadback)
+{
+    constexpr int numAgents = 2, w = 128, h = 72;
+
+    Envs envs;
+    envs.emplace_back(std::make_unique<Env>("TowerBuilding", numAgents));
+    envs.back()->reset();
+
+    MagnumEnvRenderer renderer{envs, w, h}, pboRenderer{envs, w, h};
+
+    for (auto mode : {ReadbackMode::Pbo, ReadbackMode::PboDelayed}) {
+        pboRenderer.setReadbackMode(mode);
+
+        for (auto r : {&renderer, &pboRenderer}) {
+            r->reset(*envs[0], 0);
+
+            // nothing moves, so the delayed observations are the same as the latest ones
+            for (int frame = 0; frame < 3; ++frame)
+                r->draw(envs);
+        }
+
+        for (int j = 0; j < numAgents; ++j)
+            EXPECT_EQ(0, memcmp(renderer.getObservation(0, j), pboRenderer.getObservation(0, j), w * h * 4));
+    }
+}
+
+TEST_F(EnvTest, vectorEnvChunkedScheduling)
+{
+    constexpr int numEnvs = 7, numThreads = 3, numSteps = 5;
+
+    for (int chunkSize : {1, 2, 16}) {
+        Envs envs;
+        for (int i = 0; i < numEnvs; ++i)
+            envs.emplace_back(std::make_unique<Env>("Empty", 1));
+
+        NullRenderer renderer;
+        VectorEnv vectorEnv{envs, renderer, numThreads, chunkSize};
+        vectorEnv.reset();
+        vectorEnv.resetThreadStats();
+
+        for (int i = 0; i < numSteps; ++i)
+            vectorEnv.step();
+
+        vectorEnv.close();
+
+        const auto &stats = vectorEnv.getThreadStats();
+        ASSERT_EQ(int(stats.size()), numThreads);
+
+        long long totalProcessed = 0;
+        for (const auto &s : stats) {
+            totalProcessed += s.numEnvsProcessed;
+            EXPECT_GE(s.busySec, 0.0);
+            EXPECT_GE(s.idleSec, 0.0);
+        }
+
+        // every env is stepped exactly once per step, no matter which thread picked it up
+        EXPECT_EQ(totalProcessed, numEnvs * numSteps);
+    }
+}
+
+TEST_F(EnvTest, vectorEnvStepAsync)
+{
+    constexpr int numEnvs = 4, numAgents = 2, numThreads = 2, numSteps = 10, w = 128, h = 72;
+    constexpr size_t frameSize = w * h * 4;
+
+    // observations of all agents after every step
+    auto run = [&](bool async) {
+        Envs envs;
+        for (int i = 0; i < numEnvs; ++i) {
+            envs.emplace_back(std::make_unique<Env>("TowerBuilding", numAgents));
+            envs.back()->seed(42 + i);
+        }
+
+        MagnumEnvRenderer renderer{envs, w, h};
+        VectorEnv vectorEnv{envs, renderer, numThreads};
+        vectorEnv.reset();
+        vectorEnv.resetThreadStats();
+
+        std::vector<std::vector<uint8_t>> observations;
+
+        for (int step = 0; step < numSteps; ++step) {
+            // keep turning, so every step looks different
+            for (auto &e : envs)
+                for (int agentIdx = 0; agentIdx < numAgents; ++agentIdx)
+                    e->setAction(agentIdx, Action::Forward | Action::LookLeft);
+
+            if (async) {
+                vectorEnv.stepAsync();
+                vectorEnv.waitStep();
+            } else {
+                vectorEnv.step();
+            }
+
+            observations.emplace_back();
+            for (int envIdx = 0; envIdx < numEnvs; ++envIdx)
+                for (int agentIdx = 0; agentIdx < numAgents; ++agentIdx) {
+                    const auto obs = renderer.getObservation(envIdx, agentIdx);
+                    observations.back().insert(observations.back().end(), obs, obs + frameSize);
+                }
+        }
+
+        // synchronous steps still work after switching the renderer to snapshots
+        vectorEnv.step();
+        vectorEnv.close();
+
+        long long totalProcessed = 0;
+        for (const auto &s : vectorEnv.getThreadStats())
+            totalProcessed += s.numEnvsProcessed;
+
+        EXPECT_EQ(totalProcessed, numEnvs * (numSteps + 1));
+
+        return observations;
+    };
+
+    const auto syncObservations = run(false), asyncObservations = run(true);
+
+    // the first async step renders the state right after the reset, after that the observations are exactly
+    // one step behind
+    for (int step = 2; step < numSteps; ++step) {
+        EXPECT_TRUE(syncObservations[step - 1] != syncObservations[step - 2]);
+        EXPECT_TRUE(asyncObservations[step] == syncObservations[step - 1]) << "step " << step;
+    }
+}
+
+TEST_F(EnvTest, vectorEnvAutoReset)
+{
+    constexpr int numEnvs = 5, numAgents = 2, numThreads = 3, numSteps = 60, w = 128, h = 72;
+    constexpr size_t frameSize = w * h * 4;
+
+    // episodes of a few steps, so every env finishes several of them
+    const FloatParams params{{Str::episodeLengthSec, 0.5f}};
+
+    for (bool async : {false, true}) {
+        Envs envs;
+        for (int i = 0; i < numEnvs; ++i) {
+            envs.emplace_back(std::make_unique<Env>(i % 2 ? "Collect" : "TowerBuilding", numAgents, params));
+            envs.back()->seed(42 + i);
+        }
+
+        MagnumEnvRenderer renderer{envs, w, h}, refRenderer{envs, w, h};
+        VectorEnv vectorEnv{envs, renderer, numThreads};
+        vectorEnv.reset();
+
+        for (int envIdx = 0; envIdx < numEnvs; ++envIdx)
+            refRenderer.reset(*envs[envIdx], envIdx);
+
+        // first frames of the new episodes rendered from scratch, the async observations show them one step later
+        std::vector<std::vector<uint8_t>> expected(numEnvs);
+        std::vector<uint64_t> episodeIds(numEnvs);
+        int numResets = 0;
+
+        for (int step = 0; step < numSteps; ++step) {
+            for (int envIdx = 0; envIdx < numEnvs; ++envIdx)
+                episodeIds[envIdx] = envs[envIdx]->getEpisodeId();
+
+            if (async) {
+                vectorEnv.stepAsync();
+                vectorEnv.waitStep();
+            } else {
+                vectorEnv.step();
+            }
+
+            auto checkObservations = [&](int envIdx) {
+                for (int agentIdx = 0; agentIdx < numAgents; ++agentIdx)
+                    EXPECT_EQ(0, memcmp(renderer.getObservation(envIdx, agentIdx), expected[envIdx].data() + agentIdx * frameSize, frameSize))
+                        << "async " << async << " step " << step << " env " << envIdx << " agent " << agentIdx;
+
+                expected[envIdx].clear();
+            };
+
+            for (int envIdx = 0; envIdx < numEnvs; ++envIdx)
+                if (!expected[envIdx].empty())
+                    checkObservations(envIdx);
+
+            for (int envIdx = 0; envIdx < numEnvs; ++envIdx) {
+                auto &env = *envs[envIdx];
+
+                if (!vectorEnv.done[envIdx]) {
+                    EXPECT_EQ(env.getEpisodeId(), episodeIds[envIdx]);
+                    continue;
+                }
+
+                // the worker thread already started the next episode
+                ++numResets;
+                EXPECT_NE(env.getEpisodeId(), episodeIds[envIdx]);
+                EXPECT_FALSE(env.isDone());
+
+                refRenderer.reset(env, envIdx);
+                refRenderer.draw(envs);
+                for (int agentIdx = 0; agentIdx < numAgents; ++agentIdx) {
+                    const auto obs = refRenderer.getObservation(envIdx, agentIdx);
+                    expected[envIdx].insert(expected[envIdx].end(), obs, obs + frameSize);
+                }
+
+                if (!async)
+                    checkObservations(envIdx);
+            }
+        }
+
+        vectorEnv.close();
+
+        EXPECT_GE(numResets, 2 * numEnvs) << "async " << async;
+    }
+}
+
+TEST_F(EnvTest, episodePregeneration)
+{
+    constexpr int numAgents = 2, numEpisodes = 4, numSteps = 20;
+
+    // layout, agent positions and rewards of every episode
+    auto run = [](bool pregenerate) {
+        Env env{"ObstaclesHard", numAgents};
+        env.setEpisodePregeneration(pregenerate);
+        env.seed(42);
+
+        std::vector<float> result;
+
+        for (int episode = 0; episode < numEpisodes; ++episode) {
+            env.reset();
+
+            // changed once, has to be carried over to all pregenerated episodes
+            if (episode == 0)
+                env.getScenario().setRewardShaping(0, {{Str::teamSpirit, 0.3f}});
+
+            EXPECT_FLOAT_EQ(env.getScenario().getRewardShaping(0).at(Str::teamSpirit), 0.3f);
+
+            for (const auto &[drawableType, drawables] : env.getStaticDrawables())
+                for (const auto &drawable : drawables)
+                    result.push_back(drawable.transformationMatrix.translation().sum());
+
+            for (int step = 0; step < numSteps; ++step) {
+                for (int i = 0; i < numAgents; ++i)
+                    env.setAction(i, Action::Forward | Action::LookLeft);
+
+                env.step();
+            }
+
+            for (int i = 0; i < numAgents; ++i) {
+                const auto t = env.getAgents()[i]->absoluteTransformation().translation();
+                result.insert(result.end(), {t.x(), t.y(), t.z(), env.getTotalReward(i)});
+            }
+        }
+
+        return result;
+    };
+
+    const auto synchronous = run(false), pregenerated = run(true);
+
+    ASSERT_EQ(synchronous.size(), pregenerated.size());
+    for (size_t i = 0; i < synchronous.size(); ++i)
+        EXPECT_FLOAT_EQ(synchronous[i], pregenerated[i]) << "value " << i;
+}
+
+TEST_F(EnvTest, physicsWorldReuse)
+{
+    constexpr int numAgents = 2, numEpisodes = 4, numSteps = 100;
+
+    // agent positions and rewards after every step of every episode, with the same random actions
+    auto run = [](const std::string &scenario, bool reuseWorld) {
+        Env env{scenario, numAgents};
+        env.setPhysicsWorldReuse(reuseWorld);
+        env.seed(42);
+
+        std::mt19937 rng{123};
+        std::vector<float> result;
+
+        for (int episode = 0; episode < numEpisodes; ++episode) {
+            env.reset();
+
+            for (int step = 0; step < numSteps && !env.isDone(); ++step) {
+                for (int i = 0; i < numAgents; ++i)
+                    env.setAction(i, Action(rng() & 0x7fe));
+
+                env.step();
+
+                for (int i = 0; i < numAgents; ++i) {
+                    const auto t = env.getAgents()[i]->absoluteTransformation().translation();
+                    result.insert(result.end(), {t.x(), t.y(), t.z(), env.getTotalReward(i)});
+                }
+            }
+        }
+
+        return result;
+    };
+
+    for (const auto scenario : {"ObstaclesHard", "Collect", "TowerBuilding"}) {
+        const auto reused = run(scenario, true), recreated = run(scenario, false);
+
+        ASSERT_EQ(reused.size(), recreated.size()) << scenario;
+        for (size_t i = 0; i < reused.size(); ++i)
+            EXPECT_NEAR(reused[i], recreated[i], 1e-4f) << scenario << " value " << i;
+    }
+}
+
+TEST_F(EnvTest, kinematicFastPath)
+{
+    constexpr int numAgents = 4, numSteps = 1500;
+
+    // agent positions and rewards after every step, with the same random actions
+    auto run = [](const std::string &scenario, bool fastPath, const RewardShaping &shaping) {
+        Env env{scenario, numAgents};
+        env.setKinematicFastPath(fastPath);
+        env.seed(7);
+        env.reset();
+
+        for (int i = 0; i < numAgents; ++i)
+            env.getScenario().setRewardShaping(i, shaping);
+
+        std::mt19937 rng{123};
+        std::vector<float> result;
+
+        for (int step = 0; step < numSteps; ++step) {
+            // any combination of the movement, look and interact bits
+            for (int i = 0; i < numAgents; ++i)
+                env.setAction(i, Action(rng() & 0x7fe));
+
+            env.step();
+
+            for (int i = 0; i < numAgents; ++i) {
+                const auto t = env.getAgents()[i]->absoluteTransformation().translation();
+                result.insert(result.end(), {t.x(), t.y(), t.z(), env.getTotalReward(i)});
+            }
+
+            if (env.isDone())
+                env.reset();
+        }
+
+        return result;
+    };
+
+    // only the pick up reward, so a positive total reward means an agent carried an object
+    const RewardShaping towerShaping{
+        {Str::teamSpirit, 0.0f}, {Str::towerPickedUpObject, 1.0f},
+        {Str::towerVisitedBuildingZoneWithObject, 0.0f}, {Str::towerBuildingReward, 0.0f},
+    };
+
+    // on BoxAGone the platforms disappear under the agents
+    for (const auto &[scenario, shaping] : {std::make_pair("TowerBuilding", towerShaping), std::make_pair("BoxAGone", RewardShaping{})}) {
+        const auto fullStep = run(scenario, false, shaping), kinematicStep = run(scenario, true, shaping);
+
+        ASSERT_EQ(fullStep.size(), kinematicStep.size());
+        for (size_t i = 0; i < fullStep.size(); ++i)
+            ASSERT_FLOAT_EQ(fullStep[i], kinematicStep[i]) << scenario << " value " << i;
+
+        if (shaping == towerShaping) {
+            bool pickedUp = false;
+            for (size_t i = 3; i < fullStep.size(); i += 4)
+                pickedUp = pickedUp || fullStep[i] > 0;
+
+            EXPECT_TRUE(pickedUp) << "no object was carried, the test does not cover carrying";
+        }
+    }
+}
+
+TEST_F(EnvTest, mergedStaticGeometry)
+{
+    constexpr int numAgents = 2, numSteps = 300;
+
+    for (const auto scenario : {"ObstaclesHard", "Collect"}) {
+        std::vector<float> trajectories[2];
+        int numCollisionObjects[2], numLayoutBoxes = 0;
+
+        for (bool merge : {false, true}) {
+            Env env{scenario, numAgents};
+            env.setStaticGeometryMerging(merge);
+            env.seed(3);
+            env.reset();
+
+            auto &physics = env.getPhysics();
+            numCollisionObjects[merge] = physics.bWorld.getNumCollisionObjects();
+
+            if (merge) {
+                ASSERT_NE(physics.staticLayoutShape, nullptr) << scenario;
+                numLayoutBoxes = physics.staticLayoutShape->getNumChildShapes();
+            } else {
+                EXPECT_EQ(physics.staticLayoutShape, nullptr) << scenario;
+            }
+
+            std::mt19937 rng{5};
+            for (int step = 0; step < numSteps && !env.isDone(); ++step) {
+                for (int i = 0; i < numAgents; ++i)
+                    env.setAction(i, Action(rng() & 0x7fe));
+
+                env.step();
+
+                for (int i = 0; i < numAgents; ++i) {
+                    const auto t = env.getAgents()[i]->absoluteTransformation().translation();
+                    trajectories[merge].insert(trajectories[merge].end(), {t.x(), t.y(), t.z()});
+                }
+            }
+        }
+
+        // all layout boxes collapse into a single body, nothing else changes
+        EXPECT_GT(numLayoutBoxes, 1) << scenario;
+        EXPECT_EQ(numCollisionObjects[true], numCollisionObjects[false] - numLayoutBoxes + 1) << scenario;
+
+        ASSERT_EQ(trajectories[false].size(), trajectories[true].size()) << scenario;
+        for (size_t i = 0; i < trajectories[false].size(); ++i)
+            ASSERT_NEAR(trajectories[false][i], trajectories[true][i], 1e-4f) << scenario << " value " << i;
+    }
+}
+
+TEST_F(EnvTest, sharedBoxShapes)
+{
+    constexpr int numAgents = 2, numSteps = 300;
+
+    std::vector<float> trajectories[2];
+
+    // static boxes with shapes from the cache, or with unit boxes of their own scaled with setLocalScaling()
+    for (bool localScaling : {false, true}) {
+        std::vector<std::unique_ptr<btBoxShape>> unitBoxes;
+
+        Env env{"ObstaclesHard", numAgents};
+        env.seed(3);
+        env.reset();
+
+        auto &bWorld = env.getPhysics().bWorld;
+        for (int i = 0; localScaling && i < bWorld.getNumCollisionObjects(); ++i) {
+            auto object = bWorld.getCollisionObjectArray()[i];
+            if (!object->isStaticObject() || object->getCollisionShape()->getShapeType() != BOX_SHAPE_PROXYTYPE)
+                continue;
+
+            const auto cachedShape = static_cast<btBoxShape *>(object->getCollisionShape());
+            unitBoxes.emplace_back(std::make_unique<btBoxShape>(btVector3{1, 1, 1}));
+            unitBoxes.back()->setLocalScaling(cachedShape->getHalfExtentsWithMargin());
+
+            object->setCollisionShape(unitBoxes.back().get());
+            bWorld.getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(object->getBroadphaseHandle(), bWorld.getDispatcher());
+        }
+
+        if (localScaling) {
+            // far fewer shapes than boxes
+            EXPECT_GT(int(unitBoxes.size()), 1);
+            EXPECT_LT(env.getPhysics().boxShapes.size(), unitBoxes.size());
+        }
+
+        std::mt19937 rng{5};
+        for (int step = 0; step < numSteps && !env.isDone(); ++step) {
+            for (int i = 0; i < numAgents; ++i)
+                env.setAction(i, Action(rng() & 0x7fe));
+
+            env.step();
+
+            for (int i = 0; i < numAgents; ++i) {
+                const auto t = env.getAgents()[i]->absoluteTransformation().translation();
+                trajectories[localScaling].insert(trajectories[localScaling].end(), {t.x(), t.y(), t.z()});
+            }
+        }
+    }
+
+    ASSERT_EQ(trajectories[false].size(), trajectories[true].size());
+    for (size_t i = 0; i < trajectories[false].size(); ++i)
+        ASSERT_NEAR(trajectories[false][i], trajectories[true][i], 1e-4f) << "value " << i;
+}
+
+TEST(ActionTest, decodeAction)
+{
+    const int idle[] = {0, 0, 0, 0, 0, 0};
+    EXPECT_EQ(Env::decodeAction(idle), Action::Idle);
+
+    const int actions[] = {1, 0, 2, 1, 0, 2};
+    EXPECT_EQ(Env::decodeAction(actions), Action::Left | Action::LookRight | Action::Jump | Action::LookUp);
+
+    const int actions2[] = {2, 1, 1, 0, 1, 1};
+    EXPECT_EQ(Env::decodeAction(actions2), Action::Right | Action::Forward | Action::LookLeft | Action::Interact | Action::LookDown);
+}
+
+TEST_F(EnvTest, frameskip)
+{
+    auto numStepsInEpisode = [](int frameskip) {
+        Env env{"Empty", 1};
+        env.setFrameskip(frameskip);
+        env.reset();
+
+        int numSteps = 0;
+        while (!env.isDone()) {
+            env.step();
+            ++numSteps;
+        }
+
+        return numSteps;
+    };
+
+    const auto numFrames = numStepsInEpisode(1);
+    EXPECT_GT(numFrames, 1);
+
+    // the last step ends early when the episode is done
+    for (int frameskip : {2, 3, 4})
+        EXPECT_EQ(numStepsInEpisode(frameskip), (numFrames + frameskip - 1) / frameskip);
+}
+
+TEST_F(EnvTest, vectorEnvEpisodeStats)
+{
+    constexpr int numEnvs = 3, numAgents = 2;
+
+    Envs envs;
+    for (int i = 0; i < numEnvs; ++i) {
+        envs.emplace_back(std::make_unique<Env>(i == 0 ? "Empty" : "Collect", numAgents));
+        envs.back()->setFrameskip(16);
+    }
+
+    NullRenderer renderer;
+    VectorEnv vectorEnv{envs, renderer, 2};
+    vectorEnv.reset();
+
+    EXPECT_EQ(vectorEnv.getScenarioNames(), (std::vector<std::string>{"Empty", "Collect"}));
+
+    int numFinished = 0;
+    for (int step = 0; step < 1000 && numFinished < numEnvs * numAgents; ++step) {
+        vectorEnv.step();
+
+        for (const auto &s : vectorEnv.collectEpisodeStats()) {
+            EXPECT_TRUE(vectorEnv.done[s.envIdx]);
+            EXPECT_EQ(s.scenarioId, s.envIdx == 0 ? 0 : 1);
+            EXPECT_GT(s.length, 0);
+            ++numFinished;
+        }
+    }
+
+    vectorEnv.close();
+
+    EXPECT_GE(numFinished, numEnvs * numAgents);
+    EXPECT_TRUE(vectorEnv.collectEpisodeStats().empty());
+}
+
+TEST_F(EnvTest, vectorEnvMixedScenarios)
+{
+    constexpr int numSteps = 5, w = 128, h = 72;
+    constexpr size_t frameSize = w * h * 4;
+
+    const std::vector<std::pair<std::string, int>> envSpecs{{"TowerBuilding", 1}, {"Collect", 3}, {"ObstaclesEasy", 1}, {"HexExplore", 3}};
+    const auto numEnvs = int(envSpecs.size());
+
+    auto makeEnvs = [&] {
+        Envs envs;
+        for (int i = 0; i < numEnvs; ++i) {
+            envs.emplace_back(std::make_unique<Env>(envSpecs[i].first, envSpecs[i].second));
+            envs.back()->seed(42 + i);
+        }
+        return envs;
+    };
+
+    // same actions in the vector env and in the standalone twins of its envs
+    auto setActions = [](Env &env, int step) {
+        for (int agentIdx = 0; agentIdx < env.getNumAgents(); ++agentIdx)
+            env.setAction(agentIdx, agentIdx % 2 ? Action::Forward | Action::LookLeft : Action::Backward | Action::LookRight);
+        if (step == 0)
+            env.setAction(0, Action::Jump);
+    };
+
+    for (bool atlas : {false, true}) {
+        Envs envs = makeEnvs(), twins = makeEnvs();
+
+        MagnumEnvRenderer renderer{envs, w, h};
+        if (atlas)
+            ASSERT_TRUE(renderer.enableAtlas());
+
+        VectorEnv vectorEnv{envs, renderer, 2};
+        vectorEnv.reset();
+
+        for (auto &twin : twins)
+            twin->reset();
+
+        for (int step = 0; step < numSteps; ++step) {
+            for (int i = 0; i < numEnvs; ++i) {
+                setActions(*envs[i], step);
+                setActions(*twins[i], step);
+                twins[i]->step();
+            }
+
+            vectorEnv.step();
+        }
+
+        vectorEnv.close();
+
+        // every observation of the batch is the same as the one of the env rendered on its own
+        for (int i = 0; i < numEnvs; ++i) {
+            ASSERT_FALSE(vectorEnv.done[i]);
+
+            Envs single;
+            single.emplace_back(std::move(twins[i]));
+
+            MagnumEnvRenderer singleRenderer{single, w, h};
+            singleRenderer.reset(*single.front(), 0);
+            singleRenderer.draw(single);
+
+            for (int j = 0; j < envSpecs[i].second; ++j)
+                EXPECT_EQ(0, memcmp(renderer.getObservation(i, j), singleRenderer.getObservation(0, j), frameSize))
+                    << "atlas " << atlas << " env " << envSpecs[i].first << " agent " << j;
+        }
+    }
+}
+
+TEST_F(EnvTest, snapshotRestore)
+{
+    constexpr int numAgents = 2, numSteps = 30;
+
+    for (const auto scenario : {"Collect", "ObstaclesHard"}) {
+        Env env{scenario, numAgents};
+        env.seed(42);
+        env.reset();
+
+        std::vector<Action> actions;
+        Rng rng{7};
+        for (int i = 0; i < numSteps * numAgents; ++i)
+            actions.emplace_back(Action(randRange(0, 1 << int(Action::NumActions), rng)));
+
+        auto rollout = [&] {
+            std::vector<float> trajectory;
+            for (int step = 0; step < numSteps && !env.isDone(); ++step) {
+                for (int i = 0; i < numAgents; ++i)
+                    env.setAction(i, actions[step * numAgents + i]);
+                env.step();
+
+                for (int i = 0; i < numAgents; ++i) {
+                    const auto t = env.getAgents()[i]->absoluteTransformation().translation();
+                    trajectory.insert(trajectory.end(), {t.x(), t.y(), t.z(), env.getTotalReward(i)});
+                }
+            }
+
+            return trajectory;
+        };
+
+        for (int step = 0; step < 5; ++step)
+            env.step();
+
+        const auto snapshot = env.snapshot();
+        EXPECT_GT(snapshot.size(), size_t(0));
+
+        const auto trajectory = rollout();
+        env.restore(snapshot);
+
+        // restoring twice in a row is the same as restoring once
+        env.restore(snapshot);
+        const auto replayed = rollout();
+
+        ASSERT_EQ(trajectory.size(), replayed.size());
+        for (size_t i = 0; i < trajectory.size(); ++i)
+            EXPECT_NEAR(trajectory[i], replayed[i], 1e-4f) << scenario << " value " << i;
+    }
+}
+
+TEST_F(EnvTest, rewardShaping)
+{
+    for (const auto scenario : {"TowerBuilding", "ObstaclesWalls"}) {
+        Env env{scenario, 2};
+        auto &s = env.getScenario();
+
+        // defaults of the scenario plus teamSpirit
+        std::set<std::string> rewardNames{Str::teamSpirit.name};
+        for (const auto &[reward, value] : s.defaultRewardShaping())
+            rewardNames.insert(reward.name);
+
+        auto rs = s.getRewardShaping(0);
+        EXPECT_EQ(rs, s.getRewardShaping(1));
+        EXPECT_EQ(rs.size(), rewardNames.size());
+        for (const auto &name : rewardNames)
+            EXPECT_TRUE(rs.count(name)) << name;
+
+        // unknown rewards are ignored, the rest keeps the values
+        s.setRewardShaping(1, {{Str::teamSpirit, 0.5f}, {"noSuchReward", 1.0f}});
+        rs[Str::teamSpirit] = 0.5f;
+
+        EXPECT_EQ(s.getRewardShaping(1), rs);
+        EXPECT_NE(s.getRewardShaping(0), rs);
+    }
+
+    // later defaults override earlier ones
+    Env env{"ObstaclesWalls", 1};
+    EXPECT_EQ(env.getScenario().getRewardShaping(0).at(Str::obstaclesAgentCarriedObjectToExit), 1.0f);
+}
+
+TEST_F(EnvTest, scenarioParameters)
+{
+    const FloatParams params{{Str::episodeLengthSec, 42.0f}, {Str::obstaclesMaxNumPlatforms, 3.0f}};
+
+    Env env{"ObstaclesHard", 1, params};
+    EXPECT_TRUE(env.hasParameter(Str::obstaclesMaxNumPlatforms));
+    EXPECT_FALSE(env.hasParameter("noSuchParameter"));
+
+    // resolved once in the constructor, no episode generated yet
+    EXPECT_FLOAT_EQ(env.episodeLengthSec(), 42.0f);
+
+    // obstacle parameters are unknown to this scenario
+    Env collect{"Collect", 1, params, true};
+    EXPECT_FALSE(collect.hasParameter(Str::obstaclesMaxNumPlatforms));
+    EXPECT_FLOAT_EQ(collect.episodeLengthSec(), 42.0f);
+}
@@ -0,0 +1,246 @@
+#include <map>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <util/filesystem_utils.hpp>
+
+#include <env/voxel_state.hpp>
+
+#include <scenarios/level_cache.hpp>
+#include <scenarios/scenario_collect.hpp>
+#include <scenarios/scenario_obstacles.hpp>
+
+
+using namespace Megaverse;
+
+
+namespace
+{
+
+/**
+ * Fresh directory under $TMPDIR (or /tmp), every test gets its own file names because the caches stay mapped.
+ */
+std::string makeTempDir()
+{
+    const char *tmpDir = std::getenv("TMPDIR");
+    auto path = pathJoin(tmpDir && *tmpDir ? tmpDir : "/tmp", "megaverse_level_cache_XXXXXX");
+    EXPECT_NE(mkdtemp(path.data()), nullptr) << "Could not create " << path;
+    return path;
+}
+
+using Rows = std::vector<std::vector<float>>;
+
+/**
+ * Everything the level determines about the current episode of the env, in a canonical order.
+ */
+std::map<std::string, Rows> episodeSignature(Env &env)
+{
+    std::map<std::string, Rows> signature;
+
+    Level level;
+    dynamic_cast<CacheableScenario &>(env.getScenario()).saveLevel(level);
+
+    auto colorRow = [](ColorRgb color) {
+        const auto c = uint32_t(color);
+        return std::vector<float>{float((c >> 16) & 0xff), float((c >> 8) & 0xff), float(c & 0xff)};
+    };
+
+    // the voxel grid is a hash map, its iteration order is not part of the level
+    for (const auto &v : level.voxels) {
+        auto row = std::vector<float>{float(v.coords.x()), float(v.coords.y()), float(v.coords.z()), float(v.voxelType), float(v.terrain)};
+        const auto color = colorRow(v.color);
+        row.insert(row.end(), color.begin(), color.end());
+        signature["voxels"].push_back(row);
+    }
+
+    for (const auto &t : level.terrainBoxes) {
+        const auto &bb = t.bb;
+        signature["terrainBoxes"].push_back({float(t.type), float(bb.min.x()), float(bb.min.y()), float(bb.min.z()), float(bb.max.x()), float(bb.max.y()), float(bb.max.z())});
+    }
+
+    // spawn positions are used in this order
+    for (const auto &p : level.agentPositions)
+        signature["agentSpawns"].push_back({p.x(), p.y(), p.z()});
+    for (const auto &p : level.objectPositions)
+        signature["objectSpawns"].push_back({float(p.x()), float(p.y()), float(p.z())});
+    for (const auto &p : level.rewardPositions)
+        signature["rewardSpawns"].push_back({float(p.x()), float(p.y()), float(p.z())});
+    for (auto i : level.ints)
+        signature["ints"].push_back({float(i)});
+
+    // the boxes of the layout depend on the order the grid is traversed in, the voxels they cover do not
+    for (const auto &[drawableType, drawables] : env.getStaticDrawables()) {
+        for (const auto &d : drawables) {
+            const auto min = d.transformationMatrix.transformPoint({-1.0f, -1.0f, -1.0f});
+            const auto max = d.transformationMatrix.transformPoint({1.0f, 1.0f, 1.0f});
+            const Magnum::Vector3i minCell{int(std::lround(min.x())), int(std::lround(min.y())), int(std::lround(min.z()))};
+            const Magnum::Vector3i maxCell{int(std::lround(max.x())), int(std::lround(max.y())), int(std::lround(max.z()))};
+
+            const auto color = d.color;
+            if (minCell.x() >= maxCell.x() || minCell.y() >= maxCell.y() || minCell.z() >= maxCell.z()) {
+                // not a voxel-aligned box
+                signature["staticObjects"].push_back({float(drawableType), min.x(), min.y(), min.z(), max.x(), max.y(), max.z(), color.r(), color.g(), color.b()});
+                continue;
+            }
+
+            for (int x = minCell.x(); x < maxCell.x(); ++x)
+                for (int y = minCell.y(); y < maxCell.y(); ++y)
+                    for (int z = minCell.z(); z < maxCell.z(); ++z)
+                        signature["staticCells"].push_back({float(drawableType), float(x), float(y), float(z), color.r(), color.g(), color.b()});
+        }
+    }
+
+    // parts of the agents depend on their random orientation, and the colors of the rewards in Collect are random
+    auto isAgentPart = [&env](Object3D *object) {
+        for (auto o = object; o; o = o->parent())
+            if (std::find(env.getAgents().cbegin(), env.getAgents().cend(), o) != env.getAgents().cend())
+                return true;
+
+        return false;
+    };
+
+    for (const auto &[drawableType, objects] : env.getDrawables()) {
+        for (const auto &o : objects) {
+            if (isAgentPart(o.objectPtr))
+                continue;
+
+            const auto t = o.objectPtr->absoluteTransformation().translation();
+            signature["objects"].push_back({float(drawableType), t.x(), t.y(), t.z()});
+        }
+    }
+
+    for (const auto name : {"voxels", "terrainBoxes", "staticCells", "staticObjects", "objects"})
+        std::sort(signature[name].begin(), signature[name].end());
+
+    for (int i = 0; i < env.getNumAgents(); ++i) {
+        const auto t = env.getAgents()[i]->absoluteTransformation().translation();
+        signature["agents"].push_back({t.x(), t.y(), t.z()});
+    }
+
+    return signature;
+}
+
+}
+
+
+class LevelCacheTest : public ::testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        Scenario::registerScenario("ObstaclesHard", Scenario::scenarioFactory<ObstaclesHardScenario>);
+        Scenario::registerScenario("Collect", Scenario::scenarioFactory<CollectScenario>);
+    }
+};
+
+
+TEST(levelCache, roundTrip)
+{
+    const auto dir = makeTempDir();
+    const auto filename = pathJoin(dir, "level_cache_test.bin");
+    const int numLevels = 100;
+
+    {
+        LevelCacheWriter writer{filename, "Obstacles"};
+
+        for (int i = 0; i < numLevels; ++i) {
+            Level level;
+            for (int v = 0; v < i % 10; ++v)
+                level.voxels.push_back({{v, i, -v}, VoxelState::generateType(true, true), TERRAIN_NONE, ColorRgb::GREEN});
+
+            level.terrainBoxes.push_back({TERRAIN_LAVA, {{1, 2, 3}, {4, 5, 6}}});
+            level.agentPositions = {{1.5f, 2.0f, float(i)}, {0.0f, 1.0f, 0.0f}};
+            level.objectPositions = {{i, 1, 2}};
+            level.ints = {i};
+
+            writer.add(level);
+        }
+    }
+
+    const auto cache = LevelCache::open(filename);
+    EXPECT_EQ(cache, LevelCache::open(filename));  // mapped only once
+    EXPECT_EQ(cache->size(), size_t(numLevels));
+    EXPECT_EQ(cache->getScenarioName(), "obstacles");
+
+    Level level;
+    for (int i = numLevels - 1; i >= 0; --i) {
+        cache->decode(size_t(i), level);
+
+        ASSERT_EQ(int(level.voxels.size()), i % 10);
+        for (int v = 0; v < i % 10; ++v) {
+            EXPECT_EQ(level.voxels[v].coords, VoxelCoords(v, i, -v));
+            EXPECT_EQ(level.voxels[v].voxelType, VoxelState::generateType(true, true));
+            EXPECT_EQ(level.voxels[v].color, ColorRgb::GREEN);
+        }
+
+        ASSERT_EQ(level.terrainBoxes.size(), size_t(1));
+        EXPECT_EQ(level.terrainBoxes[0].type, TERRAIN_LAVA);
+        EXPECT_EQ(level.terrainBoxes[0].bb.max, VoxelCoords(4, 5, 6));
+
+        ASSERT_EQ(level.agentPositions.size(), size_t(2));
+        EXPECT_EQ(level.agentPositions[0], Magnum::Vector3(1.5f, 2.0f, float(i)));
+        EXPECT_EQ(level.objectPositions, std::vector<VoxelCoords>{VoxelCoords(i, 1, 2)});
+        EXPECT_TRUE(level.rewardPositions.empty());
+        EXPECT_EQ(level.ints, std::vector<int>{i});
+    }
+
+    // the mapping stays valid after the file is unlinked
+    std::remove(filename.c_str());
+    rmdir(dir.c_str());
+}
+
+TEST_F(LevelCacheTest, loadGeneratedLevels)
+{
+    constexpr int numAgents = 2, numLevels = 3, numResets = 8;
+
+    const auto dir = makeTempDir();
+
+    for (const std::string scenario : {"ObstaclesHard", "Collect"}) {
+        const auto filename = pathJoin(dir, scenario + ".bin");
+
+        std::vector<std::map<std::string, Rows>> generated;
+        {
+            Env env{scenario, numAgents};
+            env.seed(11);
+
+            LevelCacheWriter writer{filename, scenario};
+            Level level;
+
+            for (int i = 0; i < numLevels; ++i) {
+                env.reset();
+                generated.emplace_back(episodeSignature(env));
+
+                dynamic_cast<CacheableScenario &>(env.getScenario()).saveLevel(level);
+                EXPECT_FALSE(level.voxels.empty()) << scenario;
+                EXPECT_GE(int(level.agentPositions.size()), numAgents) << scenario;
+                writer.add(level);
+            }
+        }
+
+        // a different seed, every episode has to be one of the cached levels, not a newly generated one
+        Env env{scenario, numAgents};
+        env.setLevelCachePath(filename);
+        env.seed(12);
+
+        for (int i = 0; i < numResets; ++i) {
+            env.reset();
+            auto signature = episodeSignature(env);
+
+            const auto match = std::find(generated.cbegin(), generated.cend(), signature);
+            EXPECT_NE(match, generated.cend()) << scenario << " reset " << i;
+
+            // a few steps in a loaded level
+            for (int step = 0; step < 5; ++step)
+                env.step();
+        }
+
+        std::remove(filename.c_str());
+    }
+
+    rmdir(dir.c_str());
+}
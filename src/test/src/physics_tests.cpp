@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include <BulletCollision/CollisionDispatch/btGhostObject.h>
+
+#include <env/env.hpp>
+#include <env/physics.hpp>
+
+
+using namespace Magnum;
+
+using namespace Megaverse;
+
+
+namespace
+{
+
+void expectNear(const btVector3 &a, const btVector3 &b, btScalar eps = 1e-5f)
+{
+    for (int i = 0; i < 3; ++i)
+        EXPECT_NEAR(a[i], b[i], eps) << "component " << i;
+}
+
+}
+
+
+TEST(BoxShapeCache, sharedShapes)
+{
+    BoxShapeCache cache;
+
+    const auto unit = cache.get(btVector3{1, 1, 1});
+    EXPECT_EQ(cache.get(btVector3{1, 1, 1}), unit);
+
+    const auto wide = cache.get(btVector3{2, 1, 1});
+    EXPECT_NE(wide, unit);
+    EXPECT_NE(cache.get(btVector3{1, 2, 1}), wide);
+    EXPECT_EQ(cache.size(), size_t(3));
+
+    // the size is in the shape itself, never in its scaling
+    expectNear(wide->getLocalScaling(), btVector3{1, 1, 1});
+    expectNear(wide->getHalfExtentsWithMargin(), btVector3{2, 1, 1});
+
+    cache.clear();
+    EXPECT_EQ(cache.size(), size_t(0));
+}
+
+TEST(RigidBody, syncPoseSwapsShape)
+{
+    Env::EnvPhysics physics;
+    Scene3D scene;
+    RigidBody body{&scene, physics.boxShapes, physics.bWorld};
+    EXPECT_EQ(body.rigidBody().getCollisionShape(), physics.boxShapes.get(btVector3{1, 1, 1}));
+
+    // overlaps the box, so there is a pair with a collision algorithm in the world's pair cache
+    btSphereShape sphereShape{0.5f};
+    btPairCachingGhostObject ghost;
+    ghost.setCollisionShape(&sphereShape);
+    ghost.setWorldTransform(btTransform{btMatrix3x3::getIdentity(), btVector3{1.2f, 0, 0}});
+    physics.bWorld.addCollisionObject(&ghost, btBroadphaseProxy::CharacterFilter, btBroadphaseProxy::AllFilter);
+
+    auto findPair = [&] {
+        auto pairCache = physics.bWorld.getBroadphase()->getOverlappingPairCache();
+        return pairCache->findPair(body.rigidBody().getBroadphaseHandle(), ghost.getBroadphaseHandle());
+    };
+
+    body.syncPose();
+    physics.bWorld.performDiscreteCollisionDetection();
+    ASSERT_NE(findPair(), nullptr);
+    EXPECT_NE(findPair()->m_algorithm, nullptr);
+
+    // same scale, same shape, the cached algorithm stays
+    body.syncPose();
+    EXPECT_NE(findPair()->m_algorithm, nullptr);
+
+    body.scale({2.0f, 1.0f, 0.5f});
+    body.syncPose();
+
+    const auto shape = body.rigidBody().getCollisionShape();
+    EXPECT_EQ(shape, physics.boxShapes.get(btVector3{2.0f, 1.0f, 0.5f}));
+    EXPECT_EQ(physics.boxShapes.size(), size_t(2));
+
+    // the algorithm was created for the old shape
+    ASSERT_NE(findPair(), nullptr);
+    EXPECT_EQ(findPair()->m_algorithm, nullptr);
+
+    physics.bWorld.performDiscreteCollisionDetection();
+    EXPECT_NE(findPair()->m_algorithm, nullptr);
+
+    // bodies of the same size share the shape
+    RigidBody other{&scene, physics.boxShapes, physics.bWorld};
+    other.scale({2.0f, 1.0f, 0.5f}).translate({10.0f, 0.0f, 0.0f});
+    other.syncPose();
+    EXPECT_EQ(other.rigidBody().getCollisionShape(), shape);
+
+    physics.bWorld.removeCollisionObject(&ghost);
+}
+
+TEST(RigidBody, cachedShapeMatchesLocalScaling)
+{
+    // the same box once with a shape from the cache, once with a unit box scaled with setLocalScaling()
+    Env::EnvPhysics cachedPhysics, scaledPhysics;
+    Scene3D cachedScene, scaledScene;
+    btBoxShape unitBox{btVector3{1, 1, 1}};
+
+    RigidBody cached{&cachedScene, cachedPhysics.boxShapes, cachedPhysics.bWorld};
+    RigidBody scaled{&scaledScene, 0.0f, &unitBox, scaledPhysics.bWorld};
+
+    const Vector3 scales[] = {{1.0f, 1.0f, 1.0f}, {0.5f, 2.0f, 3.5f}, {4.0f, 0.25f, 1.0f}};
+    const Vector3 collisionScale{1.0f, 1.1f, 0.9f};
+
+    btCapsuleShape capsule{0.3f, 0.9f};
+
+    for (const auto &scale : scales) {
+        for (auto body : {&cached, &scaled}) {
+            body->setTransformation(Matrix4::translation({1.0f, 2.0f, -3.0f}) * Matrix4::rotationY(Deg{30.0f}) * Matrix4::scaling(scale));
+            body->setCollisionScale(collisionScale);
+            body->syncPose();
+        }
+
+        cachedPhysics.bWorld.updateAabbs();
+        scaledPhysics.bWorld.updateAabbs();
+
+        btVector3 cachedMin, cachedMax, scaledMin, scaledMax;
+        cached.rigidBody().getAabb(cachedMin, cachedMax);
+        scaled.rigidBody().getAabb(scaledMin, scaledMax);
+        expectNear(cachedMin, scaledMin);
+        expectNear(cachedMax, scaledMax);
+
+        // agents move by sweeping a capsule through the world, the hits have to be the same
+        for (float x = -6.0f; x <= 6.0f; x += 0.5f) {
+            for (float y = -2.0f; y <= 6.0f; y += 0.5f) {
+                const btVector3 from{x, y, -15.0f}, to{x + 0.7f, y - 0.3f, 10.0f};
+
+                btCollisionWorld::ClosestConvexResultCallback cachedHit{from, to}, scaledHit{from, to};
+                const btTransform fromTransform{btMatrix3x3::getIdentity(), from}, toTransform{btMatrix3x3::getIdentity(), to};
+                cachedPhysics.bWorld.convexSweepTest(&capsule, fromTransform, toTransform, cachedHit);
+                scaledPhysics.bWorld.convexSweepTest(&capsule, fromTransform, toTransform, scaledHit);
+
+                ASSERT_EQ(cachedHit.hasHit(), scaledHit.hasHit()) << x << " " << y;
+                if (cachedHit.hasHit()) {
+                    EXPECT_NEAR(cachedHit.m_closestHitFraction, scaledHit.m_closestHitFraction, 1e-4f) << x << " " << y;
+                    expectNear(cachedHit.m_hitNormalWorld, scaledHit.m_hitNormalWorld, 1e-3f);
+                }
+            }
+        }
+    }
+}
+
+TEST(EnvPhysics, resetKeepsBoxShapes)
+{
+    Env::EnvPhysics physics;
+
+    for (int i = 0; i < 10; ++i)
+        physics.boxShapes.get(btVector3{1.0f + float(i), 1, 1});
+
+    // sizes repeat between episodes
+    physics.reset();
+    EXPECT_EQ(physics.boxShapes.size(), size_t(10));
+
+    for (size_t i = 0; i < Env::EnvPhysics::maxCachedBoxShapes; ++i)
+        physics.boxShapes.get(btVector3{1, 1.0f + float(i), 1});
+
+    EXPECT_GT(physics.boxShapes.size(), Env::EnvPhysics::maxCachedBoxShapes);
+    physics.reset();
+    EXPECT_EQ(physics.boxShapes.size(), size_t(0));
+}
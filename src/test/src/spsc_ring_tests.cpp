@@ -0,0 +1,55 @@
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <util/spsc_ring.hpp>
+
+
+using namespace Megaverse;
+
+
+TEST(SpscRing, fullAndEmpty)
+{
+    SpscRing<int, 4> ring;
+    EXPECT_TRUE(ring.empty());
+
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(ring.push(i));
+
+    EXPECT_FALSE(ring.push(4));
+
+    int value = -1;
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(ring.pop(value));
+        EXPECT_EQ(value, i);
+    }
+
+    EXPECT_FALSE(ring.pop(value));
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRing, twoThreads)
+{
+    constexpr int numItems = 100000;
+    SpscRing<int, 8> ring;
+
+    std::thread producer{[&ring] {
+        for (int i = 0; i < numItems; ++i)
+            while (!ring.push(i))
+                std::this_thread::yield();
+    }};
+
+    // items arrive in order and none are lost or duplicated
+    int expected = 0, value = 0;
+    while (expected < numItems) {
+        if (ring.pop(value)) {
+            ASSERT_EQ(value, expected);
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    producer.join();
+    EXPECT_TRUE(ring.empty());
+}
@@ -0,0 +1,51 @@
+#include <set>
+
+#include <gtest/gtest.h>
+
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Intersection.h>
+
+#include <rendering/static_bvh.hpp>
+
+
+using namespace Magnum;
+
+using namespace Megaverse;
+
+
+TEST(StaticBvh, frustumCulling)
+{
+    StaticDrawablesMap staticDrawables;
+    auto &boxes = staticDrawables[DrawableType::Box];
+
+    // a long row of unit boxes 10 meters in front of the camera
+    for (int x = -200; x < 200; ++x)
+        boxes.push_back({Matrix4::translation({float(x), 0.0f, -10.0f}) * Matrix4::scaling(Vector3{0.5f}), Color3{1.0f}});
+
+    const Range3D unitCube{Vector3{-1.0f}, Vector3{1.0f}};
+    StaticBvh bvh;
+    bvh.build(staticDrawables, {{DrawableType::Box, unitCube}});
+    EXPECT_EQ(bvh.size(), int(boxes.size()));
+
+    for (float yaw : {0.0f, 0.5f, 1.5f, 3.0f}) {
+        const auto camera = Matrix4::rotationY(Rad{yaw}).inverted();
+        const auto projection = Matrix4::perspectiveProjection(Deg{90.0f}, 4.0f / 3.0f, 0.01f, 50.0f);
+        const auto frustum = Frustum::fromMatrix(projection * camera);
+
+        std::set<const StaticDrawable *> visible;
+        bvh.forEachVisible(frustum, [&visible](DrawableType drawableType, const StaticDrawable &drawable) {
+            EXPECT_EQ(drawableType, DrawableType::Box);
+            EXPECT_TRUE(visible.insert(&drawable).second);
+        });
+
+        std::set<const StaticDrawable *> expected;
+        for (const auto &box : boxes) {
+            const auto center = box.transformationMatrix.translation();
+            if (Math::Intersection::rangeFrustum(Range3D{center - Vector3{0.5f}, center + Vector3{0.5f}}, frustum))
+                expected.insert(&box);
+        }
+
+        EXPECT_EQ(visible, expected);
+        EXPECT_LT(visible.size(), boxes.size() / 4);
+    }
+}
@@ -0,0 +1,86 @@
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <util/wait_policy.hpp>
+
+
+using namespace Megaverse;
+
+
+namespace
+{
+
+/**
+ * Workers wait for a round to start, the main thread waits for all of them to finish it, like in VectorEnv.
+ */
+void waitRounds(WaitPolicy policy, int numRounds)
+{
+    constexpr int numWorkers = 4;
+
+    SpinSleepEvent taskReady{policy}, workersDone{policy};
+    std::atomic<int> numFinished = 0;
+
+    std::atomic<int> round = 0;
+    std::vector<std::atomic<int>> counters(numWorkers);
+    for (auto &c : counters)
+        c = 0;
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < numWorkers; ++w) {
+        workers.emplace_back([&, w] {
+            for (int r = 1; r <= numRounds; ++r) {
+                taskReady.wait([&] { return round.load() >= r; });
+                ++counters[w];
+                if (++numFinished == numWorkers * r)
+                    workersDone.notifyAll();
+            }
+        });
+    }
+
+    for (int r = 1; r <= numRounds; ++r) {
+        round = r;
+        taskReady.notifyAll();
+        workersDone.wait([&] { return numFinished.load() >= numWorkers * r; });
+
+        // every worker finished exactly r rounds by now
+        for (const auto &c : counters)
+            ASSERT_EQ(c.load(), r);
+    }
+
+    for (auto &t : workers)
+        t.join();
+}
+
+}
+
+
+TEST(SpinSleepEvent, spin)
+{
+    // few rounds, pure spinning is very slow when there are fewer cores than threads
+    waitRounds(WaitPolicy{WaitPolicy::Type::Spin, 0}, 10);
+}
+
+TEST(SpinSleepEvent, sleep)
+{
+    waitRounds(WaitPolicy{WaitPolicy::Type::Sleep, 0}, 200);
+}
+
+TEST(SpinSleepEvent, hybrid)
+{
+    waitRounds(WaitPolicy{WaitPolicy::Type::Hybrid, 100}, 200);
+}
+
+TEST(WaitPolicy, fromString)
+{
+    bool ok = false;
+    EXPECT_EQ(waitPolicyFromString("Spin", ok), WaitPolicy::Type::Spin);
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(waitPolicyFromString("hybrid", ok), WaitPolicy::Type::Hybrid);
+    EXPECT_TRUE(ok);
+    waitPolicyFromString("yield", ok);
+    EXPECT_FALSE(ok);
+
+    EXPECT_EQ(waitPolicyToString(WaitPolicy::Type::Sleep), "sleep");
+}